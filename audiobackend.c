@@ -0,0 +1,50 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "audiobackend.h"
+
+AudioBackend *audiobackend_new(const char *spec, int numChannels,
+    int sampleRate, int blockSize, int numPeriods) {
+  // split the specification into the backend name and the device
+  char name[32];
+  const char *device = strchr(spec, ':');
+  const size_t len = (device != NULL) ? (size_t) (device - spec) : strlen(spec);
+  if (len >= sizeof(name)) return NULL;
+  memcpy(name, spec, len);
+  name[len] = '\0';
+  if (device != NULL) ++device;
+
+  AudioBackend *o = (AudioBackend *) calloc(1, sizeof(AudioBackend));
+  o->numChannels = numChannels;
+  o->sampleRate = sampleRate;
+  o->blockSize = blockSize;
+  o->numPeriods = numPeriods;
+  o->numXruns = 0;
+
+  if (!strcmp(name, "alsa")) audiobackend_alsa_init(o, false);
+  else if (!strcmp(name, "alsa-mmap")) audiobackend_alsa_init(o, true);
+  else if (!strcmp(name, "null")) audiobackend_null_init(o);
+  else if (!strcmp(name, "wav")) audiobackend_wav_init(o);
+  else {
+    printf("Unknown audio backend: %s\n", name);
+    free(o);
+    return NULL;
+  }
+
+  if (!o->open(o, device)) {
+    printf("Could not open audio backend %s\n", spec);
+    free(o->state);
+    free(o);
+    return NULL;
+  }
+  return o;
+}
+
+void audiobackend_free(AudioBackend *o) {
+  if (o == NULL) return;
+  o->stop(o);
+  o->close(o);
+  free(o);
+}
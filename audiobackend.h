@@ -0,0 +1,66 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#ifndef _HARPY_AUDIO_BACKEND_
+#define _HARPY_AUDIO_BACKEND_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct AudioBackend AudioBackend;
+
+/**
+ * An audio output device. write() takes non-interleaved float blocks and
+ * blocks until the device can accept them. A device buffer holds numPeriods
+ * blocks, just like ALSA.
+ */
+struct AudioBackend {
+  const char *name;
+  int numChannels;
+  int sampleRate;
+  int blockSize;
+  int numPeriods;
+  uint32_t numXruns;
+
+  bool (*open)(AudioBackend *o, const char *device);
+  bool (*start)(AudioBackend *o);
+  int (*write)(AudioBackend *o, float **buffers, int n); // returns the number of frames written
+  void (*stop)(AudioBackend *o);
+  int (*getLatency)(AudioBackend *o); // the device buffer latency in frames
+  void (*close)(AudioBackend *o);
+
+  void *state; // backend specific
+};
+
+// backends
+void audiobackend_alsa_init(AudioBackend *o, bool useMmap);
+void audiobackend_null_init(AudioBackend *o);
+void audiobackend_wav_init(AudioBackend *o);
+
+/**
+ * Creates and opens a backend from a specification of the form name[:device].
+ * The backends are:
+ *   alsa[:device]       ALSA, read/write access
+ *   alsa-mmap[:device]  ALSA, mmap access
+ *   null                discards all audio, paced by the monotonic clock like a device
+ *   wav:filename        writes a 32-bit float WAV file, as fast as possible
+ * Returns NULL if the backend is unknown or cannot be opened.
+ */
+AudioBackend *audiobackend_new(const char *spec, int numChannels,
+    int sampleRate, int blockSize, int numPeriods);
+
+/** Stops and closes the backend, and frees it. */
+void audiobackend_free(AudioBackend *o);
+
+static inline bool audiobackend_start(AudioBackend *o) {
+  return o->start(o);
+}
+
+static inline int audiobackend_write(AudioBackend *o, float **buffers, int n) {
+  return o->write(o, buffers, n);
+}
+
+static inline int audiobackend_getLatency(AudioBackend *o) {
+  return o->getLatency(o);
+}
+
+#endif // _HARPY_AUDIO_BACKEND_
@@ -0,0 +1,143 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#include <alsa/asoundlib.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "audiobackend.h"
+
+typedef struct {
+  snd_pcm_t *pcm;
+  bool useMmap;
+  snd_pcm_uframes_t bufferSize;
+  snd_pcm_uframes_t periodSize;
+} AlsaState;
+
+static bool alsa_recover(AudioBackend *o, int err) {
+  AlsaState *s = (AlsaState *) o->state;
+  ++o->numXruns;
+  err = snd_pcm_recover(s->pcm, err, 0);
+  if (err < 0) {
+    printf("ALSA: %s\n", snd_strerror(err));
+    return false;
+  }
+  return true;
+}
+
+// http://www.alsa-project.org/alsa-doc/alsa-lib/_2test_2pcm_min_8c-example.html
+// list all devices: $ aplay -L
+static bool alsa_open(AudioBackend *o, const char *device) {
+  AlsaState *s = (AlsaState *) o->state;
+  if (device == NULL) device = "default";
+  int err = snd_pcm_open(&s->pcm, device, SND_PCM_STREAM_PLAYBACK, 0);
+  if (err < 0) {
+    printf("ALSA: %s: %s\n", device, snd_strerror(err));
+    return false;
+  }
+  err = snd_pcm_set_params(s->pcm,
+      SND_PCM_FORMAT_FLOAT_LE,
+      s->useMmap ? SND_PCM_ACCESS_MMAP_NONINTERLEAVED : SND_PCM_ACCESS_RW_NONINTERLEAVED,
+      o->numChannels,
+      o->sampleRate,
+      0, // 0 = disallow alsa-lib resample stream, 1 = allow resampling
+      (unsigned int) (1000000.0*o->numPeriods*o->blockSize/o->sampleRate)); // required overall latency in us
+  if (err < 0) {
+    printf("ALSA: %s: %s\n", device, snd_strerror(err));
+    snd_pcm_close(s->pcm);
+    return false;
+  }
+
+  snd_pcm_get_params(s->pcm, &s->bufferSize, &s->periodSize);
+  printf("ALSA (%s):\n  * buffer size: %lu\n  * period size: %lu\n",
+      s->useMmap ? "mmap" : "rw", s->bufferSize, s->periodSize);
+  return true;
+}
+
+static bool alsa_start(AudioBackend *o) {
+  return true; // the stream starts once its buffer has been filled
+}
+
+static int alsa_write(AudioBackend *o, float **buffers, int n) {
+  AlsaState *s = (AlsaState *) o->state;
+  snd_pcm_sframes_t frames = snd_pcm_writen(s->pcm, (void **) buffers, n);
+  if (frames < 0) {
+    if (!alsa_recover(o, (int) frames)) return (int) frames;
+    frames = 0;
+  }
+  return (int) frames;
+}
+
+static int alsa_writeMmap(AudioBackend *o, float **buffers, int n) {
+  AlsaState *s = (AlsaState *) o->state;
+  int written = 0;
+  while (written < n) {
+    snd_pcm_sframes_t avail = snd_pcm_avail_update(s->pcm);
+    if (avail < 0) {
+      if (!alsa_recover(o, (int) avail)) return (int) avail;
+      continue;
+    }
+    if (avail < n-written) {
+      // the buffer is full, make sure that the stream is running and wait for room
+      if (snd_pcm_state(s->pcm) == SND_PCM_STATE_PREPARED) snd_pcm_start(s->pcm);
+      const int err = snd_pcm_wait(s->pcm, 1000);
+      if (err < 0 && !alsa_recover(o, err)) return err;
+      continue;
+    }
+
+    const snd_pcm_channel_area_t *areas = NULL;
+    snd_pcm_uframes_t offset = 0;
+    snd_pcm_uframes_t frames = n-written;
+    int err = snd_pcm_mmap_begin(s->pcm, &areas, &offset, &frames);
+    if (err < 0) {
+      if (!alsa_recover(o, err)) return err;
+      continue;
+    }
+    for (int i = 0; i < o->numChannels; ++i) {
+      char *dst = ((char *) areas[i].addr) + (areas[i].first + offset*areas[i].step)/8;
+      if (areas[i].step == 8*sizeof(float)) {
+        memcpy(dst, buffers[i]+written, frames*sizeof(float));
+      } else {
+        for (snd_pcm_uframes_t j = 0; j < frames; ++j) {
+          *((float *) (dst + j*areas[i].step/8)) = buffers[i][written+j];
+        }
+      }
+    }
+    const snd_pcm_sframes_t committed = snd_pcm_mmap_commit(s->pcm, offset, frames);
+    if (committed < 0 || (snd_pcm_uframes_t) committed != frames) {
+      if (!alsa_recover(o, (committed < 0) ? (int) committed : -EPIPE)) return (int) committed;
+      continue;
+    }
+    written += (int) frames;
+  }
+  return written;
+}
+
+static void alsa_stop(AudioBackend *o) {
+  AlsaState *s = (AlsaState *) o->state;
+  snd_pcm_drop(s->pcm);
+}
+
+static int alsa_getLatency(AudioBackend *o) {
+  return (int) ((AlsaState *) o->state)->bufferSize;
+}
+
+static void alsa_close(AudioBackend *o) {
+  AlsaState *s = (AlsaState *) o->state;
+  snd_pcm_close(s->pcm);
+  free(s);
+  o->state = NULL;
+}
+
+void audiobackend_alsa_init(AudioBackend *o, bool useMmap) {
+  AlsaState *s = (AlsaState *) calloc(1, sizeof(AlsaState));
+  s->useMmap = useMmap;
+  o->name = useMmap ? "alsa-mmap" : "alsa";
+  o->open = &alsa_open;
+  o->start = &alsa_start;
+  o->write = useMmap ? &alsa_writeMmap : &alsa_write;
+  o->stop = &alsa_stop;
+  o->getLatency = &alsa_getLatency;
+  o->close = &alsa_close;
+  o->state = s;
+}
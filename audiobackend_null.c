@@ -0,0 +1,93 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "audiobackend.h"
+
+// Discards all audio, but consumes it at the sample rate from a buffer of
+// numPeriods blocks. Like ALSA, playback starts once the buffer is full and
+// write() blocks until there is room in it.
+typedef struct {
+  struct timespec start; // the time at which the first frame is played
+  uint64_t numFrames;    // the number of frames written since start
+  bool isRunning;
+} NullState;
+
+static void timespec_add_ns(struct timespec *t, uint64_t ns) {
+  t->tv_sec += (time_t) (ns / 1000000000ULL);
+  t->tv_nsec += (long) (ns % 1000000000ULL);
+  if (t->tv_nsec >= 1000000000L) {
+    t->tv_nsec -= 1000000000L;
+    ++t->tv_sec;
+  }
+}
+
+static int64_t timespec_diff_ns(const struct timespec *end, const struct timespec *start) {
+  return ((int64_t) (end->tv_sec - start->tv_sec))*1000000000LL + (end->tv_nsec - start->tv_nsec);
+}
+
+static bool null_open(AudioBackend *o, const char *device) {
+  printf("Null audio:\n  * buffer size: %i\n  * period size: %i\n",
+      o->numPeriods*o->blockSize, o->blockSize);
+  return true;
+}
+
+static bool null_start(AudioBackend *o) {
+  NullState *s = (NullState *) o->state;
+  s->numFrames = 0;
+  s->isRunning = false;
+  return true;
+}
+
+static int null_write(AudioBackend *o, float **buffers, int n) {
+  NullState *s = (NullState *) o->state;
+  const uint64_t bufferSize = (uint64_t) o->numPeriods*o->blockSize;
+
+  // an underrun if everything written so far has already been played
+  if (s->isRunning) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (timespec_diff_ns(&now, &s->start) > (int64_t) (1000000000ULL*s->numFrames/o->sampleRate)) {
+      ++o->numXruns;
+      s->numFrames = 0; // restart the stream, like snd_pcm_recover()
+      s->isRunning = false;
+    }
+  }
+
+  s->numFrames += n;
+  if (!s->isRunning) {
+    if (s->numFrames < bufferSize) return n;
+    clock_gettime(CLOCK_MONOTONIC, &s->start); // the buffer is full, start playing
+    s->isRunning = true;
+  }
+
+  // wait until the buffer has room for the next write
+  struct timespec t = s->start;
+  timespec_add_ns(&t, 1000000000ULL*(s->numFrames-bufferSize)/o->sampleRate);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL) == EINTR);
+  return n;
+}
+
+static void null_stop(AudioBackend *o) {}
+
+static int null_getLatency(AudioBackend *o) {
+  return o->numPeriods*o->blockSize;
+}
+
+static void null_close(AudioBackend *o) {
+  free(o->state);
+  o->state = NULL;
+}
+
+void audiobackend_null_init(AudioBackend *o) {
+  o->name = "null";
+  o->open = &null_open;
+  o->start = &null_start;
+  o->write = &null_write;
+  o->stop = &null_stop;
+  o->getLatency = &null_getLatency;
+  o->close = &null_close;
+  o->state = calloc(1, sizeof(NullState));
+}
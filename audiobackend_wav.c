@@ -0,0 +1,96 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#include <endian.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "audiobackend.h"
+
+// Writes all audio to a 32-bit float WAV file, as fast as it is rendered.
+typedef struct {
+  FILE *file;
+  uint32_t numFrames;
+  float *interleaved; // one interleaved block
+} WavState;
+
+static void wav_writeHeader(AudioBackend *o) {
+  WavState *s = (WavState *) o->state;
+  const uint32_t dataSize = s->numFrames*o->numChannels*sizeof(float);
+  const uint32_t header[11] = {
+    htobe32(0x52494646),                 // "RIFF"
+    htole32(36 + dataSize),
+    htobe32(0x57415645),                 // "WAVE"
+    htobe32(0x666d7420),                 // "fmt "
+    htole32(16),                         // fmt chunk size
+    htole32((o->numChannels << 16) | 3), // format 3 (IEEE float), number of channels
+    htole32(o->sampleRate),
+    htole32(o->sampleRate*o->numChannels*sizeof(float)), // bytes per second
+    htole32((32 << 16) | (o->numChannels*sizeof(float))), // bits per sample, block align
+    htobe32(0x64617461),                 // "data"
+    htole32(dataSize)
+  };
+  fseek(s->file, 0, SEEK_SET);
+  fwrite(header, sizeof(header), 1, s->file);
+  fseek(s->file, 0, SEEK_END);
+}
+
+static bool wav_open(AudioBackend *o, const char *device) {
+  WavState *s = (WavState *) o->state;
+  if (device == NULL) device = "harpy.wav";
+  s->file = fopen(device, "wb");
+  if (s->file == NULL) {
+    printf("Could not open %s for writing.\n", device);
+    return false;
+  }
+  s->interleaved = (float *) malloc(o->numChannels*o->blockSize*sizeof(float));
+  wav_writeHeader(o);
+  printf("Writing audio to %s\n", device);
+  return true;
+}
+
+static bool wav_start(AudioBackend *o) {
+  return true;
+}
+
+static int wav_write(AudioBackend *o, float **buffers, int n) {
+  WavState *s = (WavState *) o->state;
+  for (int i = 0; i < n; i += o->blockSize) {
+    const int k = (n-i < o->blockSize) ? (n-i) : o->blockSize;
+    for (int j = 0; j < k; ++j) {
+      for (int c = 0; c < o->numChannels; ++c) {
+        s->interleaved[j*o->numChannels + c] = buffers[c][i+j]; // little endian floats
+      }
+    }
+    fwrite(s->interleaved, o->numChannels*sizeof(float), k, s->file);
+  }
+  s->numFrames += n;
+  return n;
+}
+
+static void wav_stop(AudioBackend *o) {
+  wav_writeHeader(o); // finalise the chunk sizes
+  fflush(((WavState *) o->state)->file);
+}
+
+static int wav_getLatency(AudioBackend *o) {
+  return 0;
+}
+
+static void wav_close(AudioBackend *o) {
+  WavState *s = (WavState *) o->state;
+  fclose(s->file);
+  free(s->interleaved);
+  free(s);
+  o->state = NULL;
+}
+
+void audiobackend_wav_init(AudioBackend *o) {
+  o->name = "wav";
+  o->open = &wav_open;
+  o->start = &wav_start;
+  o->write = &wav_write;
+  o->stop = &wav_stop;
+  o->getLatency = &wav_getLatency;
+  o->close = &wav_close;
+  o->state = calloc(1, sizeof(WavState));
+}
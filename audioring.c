@@ -0,0 +1,69 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "audioring.h"
+
+// a signal may interrupt the wait, such as Ctrl+C
+static void audioring_wait(sem_t *s) {
+  while (sem_wait(s) != 0 && errno == EINTR);
+}
+
+void audioring_init(AudioRing *o, int depth, int numChannels, int blockSize) {
+  o->depth = depth;
+  o->numChannels = numChannels;
+  o->blockSize = blockSize;
+  const size_t numBytes = depth*numChannels*blockSize*sizeof(float);
+  o->buffer = (float *) aligned_alloc(32, numBytes);
+  memset(o->buffer, 0, numBytes);
+  atomic_init(&o->head, 0);
+  atomic_init(&o->tail, 0);
+  sem_init(&o->numFree, 0, depth);
+  sem_init(&o->numFilled, 0, 0);
+}
+
+void audioring_free(AudioRing *o) {
+  sem_destroy(&o->numFree);
+  sem_destroy(&o->numFilled);
+  free(o->buffer);
+  o->buffer = NULL;
+  o->depth = 0;
+}
+
+static void audioring_getBlock(AudioRing *o, unsigned int index, float **channels) {
+  float *const block = o->buffer + (index % o->depth)*o->numChannels*o->blockSize;
+  for (int i = 0; i < o->numChannels; ++i) {
+    channels[i] = block + i*o->blockSize;
+  }
+}
+
+void audioring_beginWrite(AudioRing *o, float **channels) {
+  audioring_wait(&o->numFree);
+  audioring_getBlock(o, atomic_load_explicit(&o->head, memory_order_relaxed), channels);
+}
+
+void audioring_endWrite(AudioRing *o) {
+  atomic_fetch_add_explicit(&o->head, 1, memory_order_release);
+  sem_post(&o->numFilled);
+}
+
+void audioring_beginRead(AudioRing *o, float **channels) {
+  audioring_wait(&o->numFilled);
+  audioring_getBlock(o, atomic_load_explicit(&o->tail, memory_order_relaxed), channels);
+}
+
+void audioring_endRead(AudioRing *o) {
+  atomic_fetch_add_explicit(&o->tail, 1, memory_order_release);
+  sem_post(&o->numFree);
+}
+
+void audioring_wake(AudioRing *o) {
+  sem_post(&o->numFree);
+  sem_post(&o->numFilled);
+}
+
+int audioring_getNumFilled(AudioRing *o) {
+  return (int) (atomic_load_explicit(&o->head, memory_order_acquire) -
+      atomic_load_explicit(&o->tail, memory_order_acquire));
+}
@@ -0,0 +1,51 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#ifndef _HARPY_AUDIO_RING_
+#define _HARPY_AUDIO_RING_
+
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * A single-producer single-consumer ring of non-interleaved audio blocks.
+ * The indices are lock-free. The semaphores only let an idle side sleep.
+ */
+typedef struct {
+  float *buffer;
+  int depth;        // number of blocks in the ring
+  int numChannels;
+  int blockSize;    // number of frames per block
+  atomic_uint head; // total number of blocks written
+  atomic_uint tail; // total number of blocks read
+  sem_t numFree;
+  sem_t numFilled;
+} AudioRing;
+
+void audioring_init(AudioRing *o, int depth, int numChannels, int blockSize);
+
+void audioring_free(AudioRing *o);
+
+/**
+ * Waits for a free block and sets channels to point at its buffers.
+ * The buffers are aligned for Heavy's SIMD stores.
+ */
+void audioring_beginWrite(AudioRing *o, float **channels);
+
+/** Publishes the block obtained with audioring_beginWrite(). */
+void audioring_endWrite(AudioRing *o);
+
+/** Waits for a filled block and sets channels to point at its buffers. */
+void audioring_beginRead(AudioRing *o, float **channels);
+
+/** Releases the block obtained with audioring_beginRead(). */
+void audioring_endRead(AudioRing *o);
+
+/** Wakes both sides, such as when shutting down. */
+void audioring_wake(AudioRing *o);
+
+/** Returns the number of filled blocks. */
+int audioring_getNumFilled(AudioRing *o);
+
+#endif // _HARPY_AUDIO_RING_
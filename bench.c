@@ -0,0 +1,294 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+// Measures the cost of the generated contexts per sample, with a configurable
+// rate of scheduled note events. Build it once as is for the sub-block schedule
+// and once with -DHV_PROCESS_PER_VECTOR=1 to compare against the per-vector one.
+//
+// Also sweeps the vector math kernels of HvMath.h, printing their max error
+// against libm and their cost against the scalar libm functions. The kernels
+// depend on the SIMD backend, so build it once per backend, e.g. with
+// -msse4.1, -mavx, -mavx2 -mfma, or without any SIMD flags for the scalar path.
+// A bank of oscillators compares the trigonometric kernels with the libm call
+// per lane which they replaced. Build it with -DHV_FAST_TRIG=1 for the faster,
+// less accurate setting of the kernels.
+//
+// x86:
+// $ clang bench.c ./heavy/static/*.c ./heavy/slot0/*.c ./heavy/slot1/*.c ./heavy/mixer/*.c
+//   -I./heavy/static -std=c11 -D_GNU_SOURCE -DNDEBUG -Ofast -ffast-math -march=native
+//   -lm -o bench
+//
+// Cortex-A7, with the flags of build.sh:
+// $ clang bench.c ./heavy/static/*.c ./heavy/slot0/*.c ./heavy/slot1/*.c ./heavy/mixer/*.c
+//   -I./heavy/static -std=c11 -D_GNU_SOURCE -DNDEBUG -Ofast -ffast-math
+//   -mcpu=cortex-a7 -mfloat-abi=hard -mfpu=neon -march=armv7-a -mtune=cortex-a7
+//   -lm -o bench
+//
+// $ ./bench [events per second]
+//
+// Best of five runs on an x86 Xeon, gcc -Ofast -ffast-math, in ns/sample as
+// sub-block / per-vector schedule:
+//
+//                       slot0        slot1        mixer
+// SSE4.1,   100/s   2.62 / 2.74  4.06 / 4.43  0.56 / 0.83
+// SSE4.1,  1000/s   4.40 / 5.23  8.05 / 8.62  0.58 / 0.87
+// AVX2+FMA, 100/s   1.88 / 4.63  2.61 / 5.69  0.38 / 0.53
+// AVX2+FMA, 1000/s  3.78 / 6.16  6.43 / 9.55  0.36 / 0.50
+//
+// The Cortex-A7 has not been measured yet.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// heavy
+#include "heavy/slot0/Heavy_slot0.h"
+#include "heavy/slot1/Heavy_slot1.h"
+#include "heavy/mixer/Heavy_mixer.h"
+#include "HvMath.h"
+
+#define SAMPLE_RATE 48000
+#define BLOCK_SIZE 256
+#define NUM_BLOCKS 20000
+#define MATH_SWEEP_SAMPLES (1<<22) // samples over the range of a kernel, for the max error
+#define MATH_BENCH_SAMPLES 4096    // samples processed per pass, for the cost
+#define MATH_BENCH_PASSES 2000
+#define NUM_OSCILLATORS 64
+
+typedef void (VectorFunction)(hv_bInf_t, hv_bOutf_t);
+
+typedef int (ProcessFunction)(Heavy *, float **, float **, int);
+
+static int process_slot0(Heavy *c, float **inputBuffers, float **outputBuffers, int n) {
+  return hv_slot0_process((Hv_slot0 *) c, inputBuffers, outputBuffers, n);
+}
+
+static int process_slot1(Heavy *c, float **inputBuffers, float **outputBuffers, int n) {
+  return hv_slot1_process((Hv_slot1 *) c, inputBuffers, outputBuffers, n);
+}
+
+static int process_mixer(Heavy *c, float **inputBuffers, float **outputBuffers, int n) {
+  return hv_mixer_process((Hv_mixer *) c, inputBuffers, outputBuffers, n);
+}
+
+static double now_ns() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (1000000000.0 * t.tv_sec) + t.tv_nsec;
+}
+
+// schedule note events at random offsets in the coming block
+static void scheduleEvents(Heavy *context, double *debt, double eventsPerBlock) {
+  for (*debt += eventsPerBlock; *debt >= 1.0; *debt -= 1.0) {
+    const double delayMs = (1000.0 * (rand() % BLOCK_SIZE)) / SAMPLE_RATE;
+    hv_vscheduleMessageForReceiver(context, "__hv_notein", delayMs, "fffff",
+        (float) (rand() % 128), // velocity
+        (float) (36 + rand() % 48), // pitch
+        0.0f, 144.0f, 0.0f); // channel, command, port
+  }
+}
+
+static double benchmark(Heavy *context, ProcessFunction *process, double eventsPerBlock,
+    float **inputBuffers, float **outputBuffers) {
+  double debt = 0.0;
+  double elapsed = 0.0;
+  srand(0);
+  for (int i = 0; i < NUM_BLOCKS; ++i) {
+    scheduleEvents(context, &debt, eventsPerBlock);
+    const double tick = now_ns();
+    process(context, inputBuffers, outputBuffers, BLOCK_SIZE);
+    elapsed += now_ns() - tick;
+  }
+  return elapsed / (1.0 * NUM_BLOCKS * BLOCK_SIZE); // ns per sample
+}
+
+static const char *getSimdName() {
+#if HV_SIMD_AVX2 && HV_SIMD_FMA
+  return "AVX2+FMA";
+#elif HV_SIMD_AVX
+  return "AVX";
+#elif HV_SIMD_SSE
+  return "SSE4.1";
+#elif HV_SIMD_NEON
+  return "NEON";
+#else // HV_SIMD_NONE
+  return "scalar";
+#endif
+}
+
+// the input of sample i of n in [lo, hi], spaced evenly or logarithmically
+static float getSweepInput(int i, int n, double lo, double hi, bool isLogSpaced) {
+  const double t = (double) i / (n-1);
+  return (float) (isLogSpaced ? (lo * pow(hi/lo, t)) : (lo + t*(hi-lo)));
+}
+
+// Measures the max error of a vector kernel against the double precision libm
+// function over [lo, hi], absolute where |f(x)| < 1 and relative otherwise,
+// and the cost of the kernel and of the scalar libm function per sample.
+static void benchmarkMath(const char *name, VectorFunction *f,
+    float (*libmf)(float), double (*libm)(double),
+    double lo, double hi, bool isLogSpaced) {
+  static float input[MATH_BENCH_SAMPLES] __attribute__((aligned(32)));
+  static float output[MATH_BENCH_SAMPLES] __attribute__((aligned(32)));
+
+  double maxError = 0.0;
+  float maxErrorInput = 0.0f;
+  for (int i = 0; i < MATH_SWEEP_SAMPLES; i += MATH_BENCH_SAMPLES) {
+    for (int j = 0; j < MATH_BENCH_SAMPLES; ++j) {
+      input[j] = getSweepInput(i+j, MATH_SWEEP_SAMPLES, lo, hi, isLogSpaced);
+    }
+    for (int j = 0; j < MATH_BENCH_SAMPLES; j += HV_N_SIMD) {
+      hv_bufferf_t x, y;
+      __hv_load_f(input+j, &x);
+      f(x, &y);
+      __hv_store_f(output+j, y);
+    }
+    for (int j = 0; j < MATH_BENCH_SAMPLES; ++j) {
+      const double y = libm(input[j]);
+      double e = fabs(output[j] - y);
+      if (fabs(y) > 1.0) e /= fabs(y);
+      if (e > maxError) {
+        maxError = e;
+        maxErrorInput = input[j];
+      }
+    }
+  }
+
+  // the cost over the last part of the sweep
+  double tick = now_ns();
+  for (int n = 0; n < MATH_BENCH_PASSES; ++n) {
+    for (int j = 0; j < MATH_BENCH_SAMPLES; j += HV_N_SIMD) {
+      hv_bufferf_t x, y;
+      __hv_load_f(input+j, &x);
+      f(x, &y);
+      __hv_store_f(output+j, y);
+    }
+  }
+  const double kernelNs = (now_ns() - tick) / (1.0 * MATH_BENCH_PASSES * MATH_BENCH_SAMPLES);
+  tick = now_ns();
+  for (int n = 0; n < MATH_BENCH_PASSES; ++n) {
+    for (int j = 0; j < MATH_BENCH_SAMPLES; ++j) output[j] = libmf(input[j]);
+  }
+  const double libmNs = (now_ns() - tick) / (1.0 * MATH_BENCH_PASSES * MATH_BENCH_SAMPLES);
+
+  printf("%8s: max error %0.3g at %g over [%g, %g], %0.3fns/sample (libm %0.3fns/sample)\n",
+      name, maxError, maxErrorInput, lo, hi, kernelNs, libmNs);
+}
+
+// The scalar path which the trigonometric kernels replaced, unpacking the
+// buffer and calling libm for every lane.
+static void __unpack_f(float (*f)(float), hv_bInf_t bIn, hv_bOutf_t bOut) {
+  float x[HV_N_SIMD] __attribute__((aligned(32)));
+  __hv_store_f(x, bIn);
+  for (int i = 0; i < HV_N_SIMD; ++i) x[i] = f(x[i]);
+  __hv_load_f(x, bOut);
+}
+static void __unpack_sin_f(hv_bInf_t bIn, hv_bOutf_t bOut) { __unpack_f(&sinf, bIn, bOut); }
+static void __unpack_cos_f(hv_bInf_t bIn, hv_bOutf_t bOut) { __unpack_f(&cosf, bIn, bOut); }
+static void __unpack_tan_f(hv_bInf_t bIn, hv_bOutf_t bOut) { __unpack_f(&tanf, bIn, bOut); }
+static void __unpack_tanh_f(hv_bInf_t bIn, hv_bOutf_t bOut) { __unpack_f(&tanhf, bIn, bOut); }
+
+// Runs one second of a bank of phasor-driven oscillators at different
+// frequencies, each mapping its phase onto [lo, hi] and through f. Returns
+// the cost in ns per sample and oscillator.
+static double benchmarkOscillators(VectorFunction *f, double lo, double hi) {
+  static float output[BLOCK_SIZE] __attribute__((aligned(32)));
+  float lanes[HV_N_SIMD] __attribute__((aligned(32)));
+  hv_bufferf_t phases[NUM_OSCILLATORS];
+  hv_bufferf_t steps[NUM_OSCILLATORS];
+  for (int i = 0; i < NUM_OSCILLATORS; ++i) {
+    const float increment = (55.0f * (i+1)) / SAMPLE_RATE;
+    for (int j = 0; j < HV_N_SIMD; ++j) lanes[j] = j*increment;
+    __hv_load_f(lanes, phases+i);
+    steps[i] = __hv_splat_f(HV_N_SIMD*increment);
+  }
+  const hv_bufferf_t range = __hv_splat_f((float) (hi-lo));
+  const hv_bufferf_t offset = __hv_splat_f((float) lo);
+
+  const double tick = now_ns();
+  for (int n = 0; n < SAMPLE_RATE; n += BLOCK_SIZE) {
+    for (int j = 0; j < BLOCK_SIZE; j += HV_N_SIMD) {
+      hv_bufferf_t sum = __hv_splat_f(0.0f);
+      for (int i = 0; i < NUM_OSCILLATORS; ++i) {
+        hv_bufferf_t x, y;
+        __hv_floor_f(phases[i], &x);
+        __hv_sub_f(phases[i], x, phases+i);
+        __hv_fma_f(phases[i], range, offset, &x);
+        f(x, &y);
+        __hv_add_f(sum, y, &sum);
+        __hv_add_f(phases[i], steps[i], phases+i);
+      }
+      __hv_store_f(output+j, sum);
+    }
+  }
+  const double elapsed = now_ns() - tick;
+  volatile float sink = output[0]; (void) sink;
+  return elapsed / (1.0 * SAMPLE_RATE * NUM_OSCILLATORS);
+}
+
+static void compareOscillators(const char *name, VectorFunction *f, VectorFunction *unpack,
+    double lo, double hi) {
+  const double ns = benchmarkOscillators(f, lo, hi);
+  const double unpackNs = benchmarkOscillators(unpack, lo, hi);
+  printf("%8s: %0.3fns/sample (%0.3f%%CPU for %i), unpacked %0.3fns/sample (%0.3f%%CPU for %i)\n",
+      name, ns, 100.0*ns*NUM_OSCILLATORS*SAMPLE_RATE/1000000000.0, NUM_OSCILLATORS,
+      unpackNs, 100.0*unpackNs*NUM_OSCILLATORS*SAMPLE_RATE/1000000000.0, NUM_OSCILLATORS);
+}
+
+int main(int argc, char **argv) {
+  const double eventsPerSecond = (argc > 1) ? atof(argv[1]) : 100.0;
+  const double eventsPerBlock = eventsPerSecond * BLOCK_SIZE / SAMPLE_RATE;
+
+  float *buffer = (float *) aligned_alloc(32, 6*BLOCK_SIZE*sizeof(float));
+  for (int i = 0; i < 6*BLOCK_SIZE; ++i) buffer[i] = 0.0f;
+  float *inputBuffers[4] = {buffer, buffer+BLOCK_SIZE, buffer+2*BLOCK_SIZE, buffer+3*BLOCK_SIZE};
+  float *outputBuffers[2] = {buffer+4*BLOCK_SIZE, buffer+5*BLOCK_SIZE};
+
+  Heavy *contexts[3] = {
+    hv_slot0_new(SAMPLE_RATE),
+    hv_slot1_new(SAMPLE_RATE),
+    hv_mixer_new(SAMPLE_RATE)
+  };
+  ProcessFunction *processFunctions[3] = {&process_slot0, &process_slot1, &process_mixer};
+
+#if HV_PROCESS_PER_VECTOR
+  printf("per-vector schedule, ");
+#else
+  printf("sub-block schedule, ");
+#endif
+  printf("%g events/s, block size %i\n", eventsPerSecond, BLOCK_SIZE);
+
+  for (int i = 0; i < 3; ++i) {
+    const double ns = benchmark(contexts[i], processFunctions[i], eventsPerBlock, inputBuffers, outputBuffers);
+    printf("%8s: %0.3fns/sample (%0.3f%%CPU)\n",
+        hv_getName(contexts[i]), ns, 100.0*ns*SAMPLE_RATE/1000000000.0);
+  }
+
+#if __FAST_MATH__
+  printf("math kernels, %s, fast-math\n", getSimdName());
+#else
+  printf("math kernels, %s\n", getSimdName());
+#endif
+  benchmarkMath("exp", &__hv_exp_f, &expf, &exp, -87.3, 88.3, false);
+  benchmarkMath("log", &__hv_log_f, &logf, &log, 1.0e-37, 1.0e38, true);
+  benchmarkMath("log2", &__hv_log2_f, &log2f, &log2, 1.0e-37, 1.0e38, true);
+  benchmarkMath("log10", &__hv_log10_f, &log10f, &log10, 1.0e-37, 1.0e38, true);
+  benchmarkMath("sin", &__hv_sin_f, &sinf, &sin, -100.0, 100.0, false);
+  benchmarkMath("cos", &__hv_cos_f, &cosf, &cos, -100.0, 100.0, false);
+  benchmarkMath("tan", &__hv_tan_f, &tanf, &tan, -1.5, 1.5, false);
+  benchmarkMath("tan", &__hv_tan_f, &tanf, &tan, -100.0, 100.0, false);
+  benchmarkMath("tanh", &__hv_tanh_f, &tanhf, &tanh, -20.0, 20.0, false);
+
+  printf("oscillators, %s, HV_FAST_TRIG=%i\n", getSimdName(), HV_FAST_TRIG);
+  compareOscillators("sin", &__hv_sin_f, &__unpack_sin_f, -M_PI, M_PI);
+  compareOscillators("cos", &__hv_cos_f, &__unpack_cos_f, -M_PI, M_PI);
+  compareOscillators("tan", &__hv_tan_f, &__unpack_tan_f, -1.5, 1.5);
+  compareOscillators("tanh", &__hv_tanh_f, &__unpack_tanh_f, -4.0, 4.0);
+
+  hv_slot0_free((Hv_slot0 *) contexts[0]);
+  hv_slot1_free((Hv_slot1 *) contexts[1]);
+  hv_mixer_free((Hv_mixer *) contexts[2]);
+  free(buffer);
+
+  return 0;
+}
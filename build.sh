@@ -1,6 +1,8 @@
 #!/bin/bash
 
-clang main.c oscbuffer.c tinyosc/*.c \
+clang main.c oscbuffer.c osctransport.c controlring.c eventbus.c coalescer.c voicepool.c audioring.c governor.c \
+audiobackend.c audiobackend_alsa.c audiobackend_null.c audiobackend_wav.c midiinput.c \
+tinyosc/*.c \
 ./heavy/static/*.c ./heavy/slot0/*.c \
 ./heavy/rpis_osc/*.c \
 -I./heavy/static \
@@ -0,0 +1,51 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#include <string.h>
+#include "coalescer.h"
+
+void coalescer_init(Coalescer *o) {
+  memset(o, 0, sizeof(Coalescer));
+}
+
+// http://www.isthe.com/chongo/tech/comp/fnv/
+static uint32_t coalescer_hash(int slot, const char *s) {
+  uint32_t h = 2166136261u ^ (uint32_t) (slot+1);
+  while (*s != '\0') h = (h ^ (uint8_t) *s++) * 16777619u;
+  return h;
+}
+
+bool coalescer_add(Coalescer *o, int slot, const char *receiverName, float x) {
+  if (strlen(receiverName) >= COALESCER_NAME_LENGTH) return false;
+
+  // open addressing with linear probing, entries are never removed
+  const uint32_t mask = COALESCER_TABLE_SIZE-1;
+  uint32_t i = coalescer_hash(slot, receiverName) & mask;
+  for (uint32_t n = 0; n < COALESCER_TABLE_SIZE; ++n, i = (i+1) & mask) {
+    CoalescerEntry *e = o->entries+i;
+    if (e->receiverName[0] == '\0') {
+      strcpy(e->receiverName, receiverName);
+      e->slot = (int8_t) slot;
+    } else if (e->slot != slot || strcmp(e->receiverName, receiverName)) {
+      continue;
+    }
+    if (e->isPending) {
+      ++o->numCoalesced;
+    } else {
+      e->isPending = true;
+      o->pending[o->numPending++] = (uint16_t) i;
+    }
+    e->value = x;
+    return true;
+  }
+  return false; // the table is full
+}
+
+void coalescer_flush(Coalescer *o,
+    void (*fn)(int slot, const char *receiverName, float x, void *userData), void *userData) {
+  for (int i = 0; i < o->numPending; ++i) {
+    CoalescerEntry *e = o->entries + o->pending[i];
+    fn(e->slot, e->receiverName, e->value, userData);
+    e->isPending = false;
+  }
+  o->numPending = 0;
+}
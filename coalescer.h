@@ -0,0 +1,46 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#ifndef _HARPY_COALESCER_
+#define _HARPY_COALESCER_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define COALESCER_NAME_LENGTH 32
+#define COALESCER_TABLE_SIZE 256 // controls, must be a power of two
+
+typedef struct {
+  char receiverName[COALESCER_NAME_LENGTH]; // empty if the entry is unused
+  int8_t slot;      // the slot index, or -1 for the mixer
+  bool isPending;   // the value has not been sent yet
+  float value;      // the newest value
+} CoalescerEntry;
+
+/**
+ * Keeps only the newest float for each (slot, receiver) until it is flushed,
+ * so that a control which changes faster than the flush rate costs one
+ * message per flush, however many arrive. Controls are remembered once
+ * seen. When the table is full, new controls are not coalesced.
+ * It is not thread-safe, the caller must hold the lock of the patches.
+ */
+typedef struct {
+  CoalescerEntry entries[COALESCER_TABLE_SIZE];
+  uint16_t pending[COALESCER_TABLE_SIZE]; // entries with a value to send, in order of arrival
+  int numPending;
+  uint32_t numCoalesced; // values which were replaced before being sent
+} Coalescer;
+
+void coalescer_init(Coalescer *o);
+
+/**
+ * Stores a value to be sent by the next flush, replacing any value waiting
+ * for the same control. Returns false if the value could not be stored,
+ * and must be sent at once instead.
+ */
+bool coalescer_add(Coalescer *o, int slot, const char *receiverName, float x);
+
+/** Passes every waiting value to fn, in the order in which the controls first changed. */
+void coalescer_flush(Coalescer *o,
+    void (*fn)(int slot, const char *receiverName, float x, void *userData), void *userData);
+
+#endif // _HARPY_COALESCER_
@@ -0,0 +1,161 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "controlring.h"
+
+// the ring is shared between processes, so the futex may not be private
+static void futex_wait(atomic_uint *addr, unsigned int value, int timeoutMs) {
+  struct timespec ts = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+  syscall(SYS_futex, addr, FUTEX_WAIT, value, &ts, NULL, 0);
+}
+
+static void futex_wake(atomic_uint *addr) {
+  syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static bool controlring_map(ControlRing *o, int fd, size_t numBytes) {
+  void *p = mmap(NULL, numBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd); // the mapping keeps the memory alive
+  if (p == MAP_FAILED) return false;
+  o->shared = (ControlRingShared *) p;
+  o->numBytes = numBytes;
+  return true;
+}
+
+bool controlring_create(ControlRing *o, const char *name, uint32_t capacity) {
+  uint32_t n = 1;
+  while (n < capacity) n <<= 1;
+
+  o->shared = NULL;
+  o->isOwner = true;
+  o->mask = n - 1;
+  strncpy(o->name, name, sizeof(o->name)-1);
+  o->name[sizeof(o->name)-1] = '\0';
+
+  shm_unlink(name); // remove a ring left behind by a previous run
+  const int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0666);
+  if (fd < 0) return false;
+  const size_t numBytes = sizeof(ControlRingShared) + n*sizeof(ControlCell);
+  if (ftruncate(fd, (off_t) numBytes) != 0) {
+    close(fd);
+    shm_unlink(name);
+    return false;
+  }
+  if (!controlring_map(o, fd, numBytes)) {
+    shm_unlink(name);
+    return false;
+  }
+
+  ControlRingShared *s = o->shared;
+  s->capacity = n;
+  s->version = CONTROLRING_VERSION;
+  atomic_init(&s->head, 0);
+  atomic_init(&s->tail, 0);
+  atomic_init(&s->futex, 0);
+  atomic_init(&s->isWaiting, 0);
+  for (uint32_t i = 0; i < n; ++i) atomic_init(&s->cells[i].sequence, i);
+  atomic_thread_fence(memory_order_release);
+  s->magic = CONTROLRING_MAGIC; // clients may use the ring from now on
+  return true;
+}
+
+bool controlring_open(ControlRing *o, const char *name) {
+  o->shared = NULL;
+  o->isOwner = false;
+  strncpy(o->name, name, sizeof(o->name)-1);
+  o->name[sizeof(o->name)-1] = '\0';
+
+  const int fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(ControlRingShared)) {
+    close(fd);
+    return false;
+  }
+  if (!controlring_map(o, fd, (size_t) st.st_size)) return false;
+
+  ControlRingShared *s = o->shared;
+  if (s->magic != CONTROLRING_MAGIC || s->version != CONTROLRING_VERSION ||
+      sizeof(ControlRingShared) + s->capacity*sizeof(ControlCell) > o->numBytes) {
+    controlring_close(o);
+    return false;
+  }
+  o->mask = s->capacity - 1;
+  return true;
+}
+
+void controlring_close(ControlRing *o) {
+  if (o->shared == NULL) return;
+  munmap(o->shared, o->numBytes);
+  o->shared = NULL;
+  if (o->isOwner) shm_unlink(o->name);
+}
+
+// http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+bool controlring_push(ControlRing *o, const ControlEvent *e) {
+  ControlRingShared *s = o->shared;
+  unsigned int pos = atomic_load_explicit(&s->head, memory_order_relaxed);
+  ControlCell *cell = NULL;
+  while (true) {
+    cell = s->cells + (pos & o->mask);
+    const unsigned int seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    const int diff = (int) (seq - pos);
+    if (diff == 0) {
+      // the cell is free, try to claim it
+      if (atomic_compare_exchange_weak_explicit(&s->head, &pos, pos+1,
+          memory_order_relaxed, memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      return false; // the ring is full
+    } else {
+      pos = atomic_load_explicit(&s->head, memory_order_relaxed);
+    }
+  }
+  cell->event = *e;
+  atomic_store_explicit(&cell->sequence, pos+1, memory_order_release);
+
+  // wake the consumer only if it is asleep
+  atomic_fetch_add(&s->futex, 1);
+  if (atomic_load(&s->isWaiting)) futex_wake(&s->futex);
+  return true;
+}
+
+bool controlring_pop(ControlRing *o, ControlEvent *e) {
+  ControlRingShared *s = o->shared;
+  const unsigned int pos = atomic_load_explicit(&s->tail, memory_order_relaxed);
+  ControlCell *cell = s->cells + (pos & o->mask);
+  const unsigned int seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+  if ((int) (seq - (pos+1)) < 0) return false; // the ring is empty
+  *e = cell->event;
+  atomic_store_explicit(&s->tail, pos+1, memory_order_relaxed);
+  atomic_store_explicit(&cell->sequence, pos+o->mask+1, memory_order_release);
+  return true;
+}
+
+static bool controlring_isEmpty(ControlRing *o) {
+  ControlRingShared *s = o->shared;
+  const unsigned int pos = atomic_load_explicit(&s->tail, memory_order_relaxed);
+  const ControlCell *cell = s->cells + (pos & o->mask);
+  return (int) (atomic_load_explicit(&cell->sequence, memory_order_acquire) - (pos+1)) < 0;
+}
+
+void controlring_wait(ControlRing *o, int timeoutMs) {
+  ControlRingShared *s = o->shared;
+  atomic_store(&s->isWaiting, 1);
+  const unsigned int value = atomic_load(&s->futex);
+  // an event pushed after this point changes the futex, and the wait returns at once
+  if (controlring_isEmpty(o)) futex_wait(&s->futex, value, timeoutMs);
+  atomic_store(&s->isWaiting, 0);
+}
+
+void controlring_wake(ControlRing *o) {
+  atomic_fetch_add(&o->shared->futex, 1);
+  futex_wake(&o->shared->futex);
+}
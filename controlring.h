@@ -0,0 +1,84 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#ifndef _HARPY_CONTROL_RING_
+#define _HARPY_CONTROL_RING_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CONTROLRING_MAGIC 0x48525043 // "HRPC"
+#define CONTROLRING_VERSION 1
+#define CONTROLRING_RECEIVER_LENGTH 32
+
+typedef enum {
+  CONTROL_EVENT_FLOAT, // a float for a named receiver
+  CONTROL_EVENT_MIDI   // a note or controller message
+} ControlEventType;
+
+/** A pre-decoded control event, the equivalent of one OSC message to harpy. */
+typedef struct {
+  uint8_t type;      // ControlEventType
+  int8_t slot;       // the slot index, or -1 for the mixer
+  uint8_t midi[3];   // status byte, data1, data2
+  float value;
+  double delayMs;    // from the moment that the event is read
+  char receiverName[CONTROLRING_RECEIVER_LENGTH]; // null-terminated
+} ControlEvent;
+
+typedef struct {
+  atomic_uint sequence; // the position at which this cell can next be written or read
+  ControlEvent event;
+} ControlCell;
+
+// the layout of the shared memory
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t capacity;                // number of cells, a power of two
+  _Alignas(64) atomic_uint head;    // the next position to write, shared by all producers
+  _Alignas(64) atomic_uint tail;    // the next position to read
+  _Alignas(64) atomic_uint futex;   // changes with every event, the consumer sleeps on it
+  atomic_uint isWaiting;            // the consumer is sleeping
+  _Alignas(64) ControlCell cells[];
+} ControlRingShared;
+
+/**
+ * A bounded multi-producer single-consumer ring of control events in POSIX
+ * shared memory. harpy creates it and reads from it. Local controller
+ * processes open it and write to it without a system call, unless harpy
+ * is asleep and must be woken with a futex.
+ */
+typedef struct {
+  ControlRingShared *shared;
+  uint32_t mask;
+  size_t numBytes;
+  char name[64];
+  bool isOwner; // the creator unlinks the shared memory
+} ControlRing;
+
+/**
+ * Creates the ring under the given shared memory name (e.g. "/harpy").
+ * capacity is rounded up to a power of two. Returns false on failure.
+ */
+bool controlring_create(ControlRing *o, const char *name, uint32_t capacity);
+
+/** Opens a ring created by another process. Returns false on failure. */
+bool controlring_open(ControlRing *o, const char *name);
+
+/** Unmaps the ring, and removes it if it was created by this process. */
+void controlring_close(ControlRing *o);
+
+/** Adds an event to the ring. Returns false if the ring is full. */
+bool controlring_push(ControlRing *o, const ControlEvent *e);
+
+/** Removes the next event from the ring. Returns false if it is empty. */
+bool controlring_pop(ControlRing *o, ControlEvent *e);
+
+/** Sleeps until the ring is not empty, or for at most timeoutMs. */
+void controlring_wait(ControlRing *o, int timeoutMs);
+
+/** Wakes the consumer from controlring_wait(), such as when shutting down. */
+void controlring_wake(ControlRing *o);
+
+#endif // _HARPY_CONTROL_RING_
@@ -0,0 +1,198 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "tinyosc/tinyosc.h"
+#include "eventbus.h"
+
+void eventbus_init(EventBus *o, uint32_t capacity) {
+  uint32_t n = 1;
+  while (n < capacity) n <<= 1;
+  o->cells = (BusCell *) malloc(n*sizeof(BusCell));
+  o->mask = n - 1;
+  for (uint32_t i = 0; i < n; ++i) atomic_init(&o->cells[i].sequence, i);
+  atomic_init(&o->head, 0);
+  atomic_init(&o->tail, 0);
+  atomic_init(&o->numDropped, 0);
+  atomic_init(&o->numSubscribers, 0);
+  memset(o->subscribers, 0, sizeof(o->subscribers));
+  pthread_mutex_init(&o->subscriberLock, NULL);
+  o->fd = socket(AF_INET, SOCK_DGRAM, 0);
+}
+
+void eventbus_free(EventBus *o) {
+  close(o->fd);
+  pthread_mutex_destroy(&o->subscriberLock);
+  free(o->cells);
+  o->cells = NULL;
+}
+
+// http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+bool eventbus_push(EventBus *o, const BusEvent *e) {
+  unsigned int pos = atomic_load_explicit(&o->head, memory_order_relaxed);
+  BusCell *cell = NULL;
+  while (true) {
+    cell = o->cells + (pos & o->mask);
+    const unsigned int seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    const int diff = (int) (seq - pos);
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&o->head, &pos, pos+1,
+          memory_order_relaxed, memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      atomic_fetch_add_explicit(&o->numDropped, 1, memory_order_relaxed);
+      return false; // the ring is full
+    } else {
+      pos = atomic_load_explicit(&o->head, memory_order_relaxed);
+    }
+  }
+  cell->event = *e;
+  atomic_store_explicit(&cell->sequence, pos+1, memory_order_release);
+  return true;
+}
+
+bool eventbus_pop(EventBus *o, BusEvent *e) {
+  const unsigned int pos = atomic_load_explicit(&o->tail, memory_order_relaxed);
+  BusCell *cell = o->cells + (pos & o->mask);
+  const unsigned int seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+  if ((int) (seq - (pos+1)) < 0) return false; // the ring is empty
+  *e = cell->event;
+  atomic_store_explicit(&o->tail, pos+1, memory_order_relaxed);
+  atomic_store_explicit(&cell->sequence, pos+o->mask+1, memory_order_release);
+  return true;
+}
+
+static bool eventbus_resolve(const char *host, int port, struct sockaddr_in *sin) {
+  struct addrinfo hints;
+  struct addrinfo *res = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  if (port <= 0 || port > 65535 || getaddrinfo(host, NULL, &hints, &res) != 0) return false;
+  *sin = *((struct sockaddr_in *) res->ai_addr);
+  sin->sin_port = htons(port);
+  freeaddrinfo(res);
+  return true;
+}
+
+static BusSubscriber *eventbus_find(EventBus *o, const struct sockaddr_in *sin) {
+  for (int i = 0; i < EVENTBUS_MAX_SUBSCRIBERS; ++i) {
+    BusSubscriber *s = o->subscribers+i;
+    if (s->isActive && s->address.sin_addr.s_addr == sin->sin_addr.s_addr &&
+        s->address.sin_port == sin->sin_port) return s;
+  }
+  return NULL;
+}
+
+bool eventbus_subscribe(EventBus *o, const char *host, int port, const char *filter) {
+  struct sockaddr_in sin;
+  if (!eventbus_resolve(host, port, &sin)) return false;
+  pthread_mutex_lock(&o->subscriberLock);
+  BusSubscriber *s = eventbus_find(o, &sin);
+  for (int i = 0; s == NULL && i < EVENTBUS_MAX_SUBSCRIBERS; ++i) {
+    if (!o->subscribers[i].isActive) {
+      s = o->subscribers+i;
+      s->address = sin;
+      s->isActive = true;
+      atomic_fetch_add(&o->numSubscribers, 1);
+    }
+  }
+  if (s != NULL) {
+    strncpy(s->filter, filter, EVENTBUS_NAME_LENGTH-1);
+    s->filter[EVENTBUS_NAME_LENGTH-1] = '\0';
+  }
+  pthread_mutex_unlock(&o->subscriberLock);
+  return (s != NULL);
+}
+
+void eventbus_unsubscribe(EventBus *o, const char *host, int port) {
+  struct sockaddr_in sin;
+  if (!eventbus_resolve(host, port, &sin)) return;
+  pthread_mutex_lock(&o->subscriberLock);
+  BusSubscriber *s = eventbus_find(o, &sin);
+  if (s != NULL) {
+    s->isActive = false;
+    atomic_fetch_sub(&o->numSubscribers, 1);
+  }
+  pthread_mutex_unlock(&o->subscriberLock);
+}
+
+static bool eventbus_matches(const char *filter, const char *receiverName) {
+  const size_t n = strlen(filter);
+  if (n > 0 && filter[n-1] == '*') return !strncmp(filter, receiverName, n-1);
+  return !strcmp(filter, receiverName);
+}
+
+static void eventbus_send(EventBus *o, BusSubscriber *s, tosc_bundle *b, char *buffer) {
+  if (tosc_getBundleLength(b) > 16) {
+    sendto(o->fd, buffer, tosc_getBundleLength(b), 0,
+        (struct sockaddr *) &s->address, sizeof(s->address));
+  }
+  tosc_writeBundle(b, TINYOSC_TIMETAG_IMMEDIATELY, buffer, EVENTBUS_MAX_PACKET);
+}
+
+void eventbus_flush(EventBus *o, bool (*fn)(const BusEvent *e, void *userData), void *userData) {
+  // work on a copy of the subscribers, so that fn may take other locks
+  BusSubscriber subscribers[EVENTBUS_MAX_SUBSCRIBERS];
+  int numSubscribers = 0;
+  pthread_mutex_lock(&o->subscriberLock);
+  for (int i = 0; i < EVENTBUS_MAX_SUBSCRIBERS; ++i) {
+    if (o->subscribers[i].isActive) subscribers[numSubscribers++] = o->subscribers[i];
+  }
+  pthread_mutex_unlock(&o->subscriberLock);
+
+  char buffers[EVENTBUS_MAX_SUBSCRIBERS][EVENTBUS_MAX_PACKET];
+  tosc_bundle bundles[EVENTBUS_MAX_SUBSCRIBERS];
+  for (int i = 0; i < numSubscribers; ++i) {
+    tosc_writeBundle(bundles+i, TINYOSC_TIMETAG_IMMEDIATELY, buffers[i], EVENTBUS_MAX_PACKET);
+  }
+
+  BusEvent e;
+  uint32_t block = 0;
+  bool hasBlock = false;
+  while (eventbus_pop(o, &e)) {
+    if (fn != NULL && fn(&e, userData)) continue;
+
+    // start new bundles with each block
+    if (hasBlock && e.block != block) {
+      for (int i = 0; i < numSubscribers; ++i) eventbus_send(o, subscribers+i, bundles+i, buffers[i]);
+    }
+    block = e.block;
+    hasBlock = true;
+
+    char address[16+EVENTBUS_NAME_LENGTH];
+    char format[EVENTBUS_MAX_ELEMENTS+2];
+    tosc_arg args[EVENTBUS_MAX_ELEMENTS+1];
+    int n = 0;
+    if (e.slot < 0) {
+      snprintf(address, sizeof(address), "/mixer/%s", e.receiverName);
+    } else {
+      snprintf(address, sizeof(address), "/slot/%i/%s", e.slot, e.receiverName);
+      format[n] = 'i';
+      args[n++].i = e.voice;
+    }
+    for (int j = 0; e.format[j] != '\0'; ++j, ++n) {
+      format[n] = e.format[j];
+      if (e.format[j] == 'f') args[n].f = e.elements[j].f;
+      else if (e.format[j] == 's') args[n].s = e.elements[j].s;
+    }
+    format[n] = '\0';
+
+    for (int i = 0; i < numSubscribers; ++i) {
+      if (!eventbus_matches(subscribers[i].filter, e.receiverName)) continue;
+      if (tosc_writeNextMessageWithArgs(bundles+i, address, format, args) == 0) {
+        // the bundle is full, send it and continue in a new one
+        eventbus_send(o, subscribers+i, bundles+i, buffers[i]);
+        tosc_writeNextMessageWithArgs(bundles+i, address, format, args);
+      }
+    }
+  }
+  for (int i = 0; i < numSubscribers; ++i) eventbus_send(o, subscribers+i, bundles+i, buffers[i]);
+
+  const unsigned int numDropped = atomic_exchange(&o->numDropped, 0);
+  if (numDropped > 0) printf("Event bus: %u events dropped\n", numDropped);
+}
@@ -0,0 +1,94 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#ifndef _HARPY_EVENT_BUS_
+#define _HARPY_EVENT_BUS_
+
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define EVENTBUS_MAX_ELEMENTS 4
+#define EVENTBUS_NAME_LENGTH 32
+#define EVENTBUS_SYMBOL_LENGTH 16
+#define EVENTBUS_MAX_SUBSCRIBERS 8
+#define EVENTBUS_MAX_PACKET 1472 // bytes, so that a bundle is not fragmented on ethernet
+
+/** A message sent by a patch, copied out of heavy. */
+typedef struct {
+  uint32_t block; // the block in which the message was sent
+  int8_t slot;    // the slot index, or -1 for the mixer
+  int8_t voice;   // the voice index in the slot
+  char format[EVENTBUS_MAX_ELEMENTS+1]; // 'f' float, 's' symbol, 'I' bang
+  char receiverName[EVENTBUS_NAME_LENGTH];
+  union {
+    float f;
+    char s[EVENTBUS_SYMBOL_LENGTH];
+  } elements[EVENTBUS_MAX_ELEMENTS];
+} BusEvent;
+
+typedef struct {
+  atomic_uint sequence;
+  BusEvent event;
+} BusCell;
+
+typedef struct {
+  struct sockaddr_in address;
+  char filter[EVENTBUS_NAME_LENGTH]; // a receiver name, a prefix ending in '*', or "*"
+  bool isActive;
+} BusSubscriber;
+
+/**
+ * Carries messages sent by the patches out to OSC subscribers. Any thread,
+ * including the audio and voice threads, may push events into the bounded
+ * lock-free ring. One thread drains it and sends one OSC bundle per block
+ * to each subscriber, containing the events which pass its filter.
+ *
+ * Messages are sent as /mixer/<receiver> or /slot/<index>/<receiver> with
+ * the voice index as the first argument, followed by the message elements.
+ */
+typedef struct {
+  BusCell *cells;
+  uint32_t mask;
+  atomic_uint head;       // the next position to write, shared by all producers
+  atomic_uint tail;       // the next position to read
+  atomic_uint numDropped; // events which did not fit in the ring
+  atomic_int numSubscribers;
+  BusSubscriber subscribers[EVENTBUS_MAX_SUBSCRIBERS];
+  pthread_mutex_t subscriberLock; // only taken by non-audio threads
+  int fd; // the send socket
+} EventBus;
+
+/** capacity is rounded up to a power of two. */
+void eventbus_init(EventBus *o, uint32_t capacity);
+
+void eventbus_free(EventBus *o);
+
+/** Returns true if anybody is listening, so that producers can skip the work. */
+static inline bool eventbus_hasSubscribers(EventBus *o) {
+  return atomic_load_explicit(&o->numSubscribers, memory_order_relaxed) > 0;
+}
+
+/** Adds an event to the ring from any thread. Returns false if it is full. */
+bool eventbus_push(EventBus *o, const BusEvent *e);
+
+/** Removes the next event from the ring. Only one thread may pop. */
+bool eventbus_pop(EventBus *o, BusEvent *e);
+
+/**
+ * Adds a subscriber, or changes the filter of an existing one.
+ * Returns false if the host is invalid or there are too many subscribers.
+ */
+bool eventbus_subscribe(EventBus *o, const char *host, int port, const char *filter);
+
+void eventbus_unsubscribe(EventBus *o, const char *host, int port);
+
+/**
+ * Sends everything in the ring to the subscribers, one bundle per block
+ * and subscriber. Events for which fn returns true are not sent, but
+ * passed to it instead, such as messages meant for harpy itself.
+ */
+void eventbus_flush(EventBus *o, bool (*fn)(const BusEvent *e, void *userData), void *userData);
+
+#endif // _HARPY_EVENT_BUS_
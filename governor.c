@@ -0,0 +1,89 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#include <stdio.h>
+#include <string.h>
+#include "governor.h"
+
+// weight of the newest block in the moving averages, ~50ms time constant
+#define GOVERNOR_SMOOTHING 0.1
+
+void governor_init(Governor *o, VoicePool *slots, int numSlots, double blockPeriodNs) {
+  memset(o, 0, sizeof(Governor));
+  o->slots = slots;
+  o->numSlots = (numSlots < GOVERNOR_MAX_SLOTS) ? numSlots : GOVERNOR_MAX_SLOTS;
+  o->blockPeriodNs = blockPeriodNs;
+  atomic_init(&o->logHead, 0);
+  atomic_init(&o->logTail, 0);
+
+  // reduce the polyphony of each slot to one voice, lowest priority first
+  for (int i = o->numSlots-1; i >= 0; --i) {
+    for (int n = slots[i].numVoices-1; n > 0 && o->numSteps < GOVERNOR_MAX_STEPS; --n) {
+      o->steps[o->numSteps++] = (GovernorStep) {i, n, n+1};
+    }
+  }
+  // then shut off every slot but the first
+  for (int i = o->numSlots-1; i > 0 && o->numSteps < GOVERNOR_MAX_STEPS; --i) {
+    o->steps[o->numSteps++] = (GovernorStep) {i, 0, (slots[i].numVoices > 0) ? 1 : 0};
+  }
+}
+
+static void governor_log(Governor *o, int slot, int maxVoices, int prevMaxVoices) {
+  const unsigned int head = atomic_load_explicit(&o->logHead, memory_order_relaxed);
+  const unsigned int tail = atomic_load_explicit(&o->logTail, memory_order_acquire);
+  if (head - tail >= GOVERNOR_LOG_LENGTH) return; // the log is full, drop the event
+  o->log[head & (GOVERNOR_LOG_LENGTH-1)] = (GovernorEvent) {
+    o->numBlocks, slot, maxVoices, prevMaxVoices, (float) o->load, (float) o->slotLoad[slot]
+  };
+  atomic_store_explicit(&o->logHead, head+1, memory_order_release);
+}
+
+void governor_update(Governor *o, const double *slotNs, double totalNs) {
+  ++o->numBlocks;
+  const double load = totalNs / o->blockPeriodNs;
+  o->load += GOVERNOR_SMOOTHING * (load - o->load);
+  for (int i = 0; i < o->numSlots; ++i) {
+    o->slotLoad[i] += GOVERNOR_SMOOTHING * (slotNs[i]/o->blockPeriodNs - o->slotLoad[i]);
+  }
+
+  // Repeated overruns shed load at once, otherwise only after the holdoff. A
+  // single overrun, e.g. from a page fault, only counts towards the average.
+  const bool isOverrun = (load >= 1.0);
+  if (isOverrun) {
+    ++o->numOverruns;
+    if (o->numBlocks - o->lastOverrunBlock > GOVERNOR_OVERRUN_WINDOW_BLOCKS) o->recentOverruns = 0;
+    ++o->recentOverruns;
+    o->lastOverrunBlock = o->numBlocks;
+  }
+  if (o->holdoff > 0) --o->holdoff;
+  o->headroomBlocks = (o->load < GOVERNOR_RESTORE_LOAD) ? (o->headroomBlocks+1) : 0;
+
+  if ((o->load > GOVERNOR_SHED_LOAD && o->holdoff == 0) ||
+      o->recentOverruns >= GOVERNOR_OVERRUNS_TO_SHED) {
+    if (o->level < o->numSteps) {
+      const GovernorStep *s = o->steps + o->level++;
+      voicepool_setMaxVoices(o->slots+s->slot, s->maxVoices);
+      governor_log(o, s->slot, s->maxVoices, s->prevMaxVoices);
+    }
+    o->holdoff = GOVERNOR_SHED_HOLDOFF_BLOCKS;
+    o->headroomBlocks = 0;
+    o->recentOverruns = 0;
+  } else if (o->level > 0 && o->headroomBlocks >= GOVERNOR_RESTORE_HOLDOFF_BLOCKS) {
+    const GovernorStep *s = o->steps + --o->level;
+    voicepool_setMaxVoices(o->slots+s->slot, s->prevMaxVoices);
+    governor_log(o, s->slot, s->prevMaxVoices, s->maxVoices);
+    o->headroomBlocks = 0;
+  }
+}
+
+void governor_printLog(Governor *o) {
+  unsigned int tail = atomic_load_explicit(&o->logTail, memory_order_relaxed);
+  const unsigned int head = atomic_load_explicit(&o->logHead, memory_order_acquire);
+  for (; tail != head; ++tail) {
+    const GovernorEvent *e = o->log + (tail & (GOVERNOR_LOG_LENGTH-1));
+    printf("Governor: [block %u] %s slot %i polyphony %i -> %i (load %0.1f%%, slot %0.1f%%, %u overruns)\n",
+        e->block, (e->maxVoices < e->prevMaxVoices) ? "shed" : "restored",
+        e->slot, e->prevMaxVoices, e->maxVoices,
+        100.0f*e->load, 100.0f*e->slotLoad, o->numOverruns);
+  }
+  atomic_store_explicit(&o->logTail, tail, memory_order_release);
+}
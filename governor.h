@@ -0,0 +1,82 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#ifndef _HARPY_GOVERNOR_
+#define _HARPY_GOVERNOR_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "voicepool.h"
+
+#define GOVERNOR_MAX_SLOTS 8
+#define GOVERNOR_MAX_STEPS 64
+#define GOVERNOR_LOG_LENGTH 64 // must be a power of two
+
+// fractions of the block period
+#define GOVERNOR_SHED_LOAD 0.75    // shed when the average load rises above this
+#define GOVERNOR_RESTORE_LOAD 0.45 // restore when it stays below this
+
+#define GOVERNOR_SHED_HOLDOFF_BLOCKS 8       // blocks between two shedding steps
+#define GOVERNOR_RESTORE_HOLDOFF_BLOCKS 375  // blocks of headroom before each restoring step, ~2s
+#define GOVERNOR_OVERRUNS_TO_SHED 2          // overruns within the window which shed at once
+#define GOVERNOR_OVERRUN_WINDOW_BLOCKS 16
+
+typedef struct {
+  int slot;
+  int maxVoices;     // the polyphony limit of the slot at this step
+  int prevMaxVoices; // the limit to restore when stepping back
+} GovernorStep;
+
+typedef struct {
+  uint32_t block;
+  int slot;
+  int maxVoices;
+  int prevMaxVoices;
+  float load;        // average load, as a fraction of the block period
+  float slotLoad;    // average load of the slot
+} GovernorEvent;
+
+/**
+ * Tracks the rendering cost of each slot and sheds polyphony when the average
+ * cost nears the block period. Polyphony is taken away from the lowest priority
+ * (highest index) slot first, one voice at a time. Then whole slots are shut
+ * off, except for the first one. It is given back in reverse order when
+ * headroom returns. Every step is logged to a lock-free queue, which is
+ * printed from outside of the audio thread.
+ */
+typedef struct {
+  VoicePool *slots;
+  int numSlots;
+  double blockPeriodNs;
+
+  double load;                          // moving average of the total load
+  double slotLoad[GOVERNOR_MAX_SLOTS];  // moving average of each slot's load
+  uint32_t numBlocks;
+  uint32_t numOverruns;  // blocks which took longer than the block period
+  uint32_t lastOverrunBlock;
+  int recentOverruns;    // overruns since the last step, none more than a window apart
+  int holdoff;           // blocks to wait before the next shedding step
+  int headroomBlocks;    // consecutive blocks below the restore load
+
+  GovernorStep steps[GOVERNOR_MAX_STEPS];
+  int numSteps;
+  int level;             // the number of steps currently applied
+
+  GovernorEvent log[GOVERNOR_LOG_LENGTH];
+  atomic_uint logHead;
+  atomic_uint logTail;
+} Governor;
+
+void governor_init(Governor *o, VoicePool *slots, int numSlots, double blockPeriodNs);
+
+/**
+ * Updates the governor with the time taken to render the last block. Must be
+ * called from the audio thread, with the slots locked.
+ */
+void governor_update(Governor *o, const double *slotNs, double totalNs);
+
+/** Prints all logged events. Call from a non-realtime thread. */
+void governor_printLog(Governor *o);
+
+#endif // _HARPY_GOVERNOR_
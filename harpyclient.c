@@ -0,0 +1,48 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#include <string.h>
+#include "harpyclient.h"
+
+bool harpyclient_open(HarpyClient *o, const char *name) {
+  return controlring_open(&o->ring, name);
+}
+
+void harpyclient_close(HarpyClient *o) {
+  controlring_close(&o->ring);
+}
+
+bool harpyclient_sendFloat(HarpyClient *o, int slot, double delayMs,
+    const char *receiverName, float x) {
+  const size_t len = strlen(receiverName);
+  if (len >= CONTROLRING_RECEIVER_LENGTH) return false;
+  ControlEvent e;
+  e.type = CONTROL_EVENT_FLOAT;
+  e.slot = (int8_t) slot;
+  e.value = x;
+  e.delayMs = delayMs;
+  memcpy(e.receiverName, receiverName, len+1);
+  return controlring_push(&o->ring, &e);
+}
+
+static bool harpyclient_sendMidi(HarpyClient *o, int slot, double delayMs,
+    unsigned char status, int data1, int data2) {
+  ControlEvent e;
+  e.type = CONTROL_EVENT_MIDI;
+  e.slot = (int8_t) slot;
+  e.midi[0] = status;
+  e.midi[1] = (uint8_t) (data1 & 0x7F);
+  e.midi[2] = (uint8_t) (data2 & 0x7F);
+  e.delayMs = delayMs;
+  e.receiverName[0] = '\0';
+  return controlring_push(&o->ring, &e);
+}
+
+bool harpyclient_sendNote(HarpyClient *o, int slot, double delayMs,
+    int channel, int pitch, int velocity) {
+  return harpyclient_sendMidi(o, slot, delayMs, 0x90 | (channel & 0x0F), pitch, velocity);
+}
+
+bool harpyclient_sendControl(HarpyClient *o, int slot, double delayMs,
+    int channel, int controller, int value) {
+  return harpyclient_sendMidi(o, slot, delayMs, 0xB0 | (channel & 0x0F), controller, value);
+}
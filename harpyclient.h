@@ -0,0 +1,44 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#ifndef _HARPY_CLIENT_
+#define _HARPY_CLIENT_
+
+#include <stdbool.h>
+
+#include "controlring.h"
+
+#define HARPYCLIENT_MIXER -1 // the slot index of the mixer
+
+/**
+ * Controls a harpy running on the same machine through its shared memory
+ * control ring, without encoding OSC or going through the network stack.
+ * A client may be used by one thread at a time. Any number of clients,
+ * in any number of processes, may be open at once.
+ *
+ * $ clang myui.c harpyclient.c controlring.c -std=c11 -lrt -o myui
+ */
+typedef struct {
+  ControlRing ring;
+} HarpyClient;
+
+/** Connects to harpy under the given name (e.g. "/harpy"). Returns false if it is not running. */
+bool harpyclient_open(HarpyClient *o, const char *name);
+
+void harpyclient_close(HarpyClient *o);
+
+/**
+ * Sends a float to the named receiver of a slot (every voice), or of the
+ * mixer. Returns false if the ring is full or the name is too long.
+ */
+bool harpyclient_sendFloat(HarpyClient *o, int slot, double delayMs,
+    const char *receiverName, float x);
+
+/** Sends a note. A velocity of 0 is a note off. */
+bool harpyclient_sendNote(HarpyClient *o, int slot, double delayMs,
+    int channel, int pitch, int velocity);
+
+/** Sends a controller change. */
+bool harpyclient_sendControl(HarpyClient *o, int slot, double delayMs,
+    int channel, int controller, int value);
+
+#endif // _HARPY_CLIENT_
@@ -81,6 +81,8 @@ HV_EXPORT Hv_mixer *hv_mixer_new_with_options(double sampleRate, int poolKb) {
   Base(_c)->blockStartTimestamp = 0;
   Base(_c)->f_scheduleMessageForReceiver = &ctx_intern_scheduleMessageForReceiver;
   Base(_c)->f_getTableForHash = &ctx_intern_getTableForHash;
+  Base(_c)->pendingTables = NULL;
+  Base(_c)->retiredTables = NULL;
   mq_initWithPoolSize(&Base(_c)->mq, poolKb);
   Base(_c)->basePath = NULL;
   Base(_c)->printHook = NULL;
@@ -142,6 +144,9 @@ extern "C" {
 HV_EXPORT int hv_mixer_process(Hv_mixer *const _c, float **const inputBuffers, float **const outputBuffers, int nx) {
   const int n4 = nx & ~HV_N_SIMD_MASK; // ensure that the block size is a multiple of HV_N_SIMD
 
+  // swap in the tables loaded by other threads
+  ctx_updateTables(Base(_c));
+
   // temporary signal vars
   hv_bufferf_t Bf0, Bf1;
 
@@ -152,50 +157,69 @@ HV_EXPORT int hv_mixer_process(Hv_mixer *const _c, float **const inputBuffers, f
   // declare and init the zero buffer
   hv_bufferf_t ZERO; __hv_zero_f(VOf(ZERO));
 
+  // declare and init the constant buffers, hoisted out of the loop
+  hv_bufferf_t K0, K1;
+  __hv_var_k_f(VOf(K0), 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0);
+  __hv_var_k_f(VOf(K1), -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 0);
+
   hv_uint32_t nextBlock = Base(_c)->blockStartTimestamp;
-  for (int n = 0; n < n4; n += HV_N_SIMD) {
+  for (int n = 0; n < n4;) {
 
     // process all of the messages for this block
-    nextBlock += HV_N_SIMD;
-    while (mq_hasMessageBefore(&Base(_c)->mq, nextBlock)) {
+    while (mq_hasMessageBefore(&Base(_c)->mq, nextBlock+HV_N_SIMD)) {
       MessageNode *const node = mq_peek(&Base(_c)->mq);
       node->sendMessage(Base(_c), node->let, node->m);
       mq_pop(&Base(_c)->mq);
     }
 
-    // load input buffers
-    __hv_load_f(inputBuffers[0]+n, VOf(I0));
-    __hv_load_f(inputBuffers[1]+n, VOf(I1));
-    __hv_load_f(inputBuffers[2]+n, VOf(I2));
-    __hv_load_f(inputBuffers[3]+n, VOf(I3));
-
-    // zero output buffers
-    __hv_zero_f(VOf(O0));
-    __hv_zero_f(VOf(O1));
-
-    // process all signal functions
-    __hv_var_f(&_c->sVarf_KrQSd, VOf(Bf0));
-    __hv_var_f(&_c->sVarf_kOnKw, VOf(Bf1));
-    __hv_mul_f(VIf(I1), VIf(Bf1), VOf(Bf1));
-    __hv_fma_f(VIf(I3), VIf(Bf0), VIf(Bf1), VOf(Bf1));
-    __hv_var_k_f(VOf(Bf0), 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0);
-    __hv_min_f(VIf(Bf1), VIf(Bf0), VOf(Bf0));
-    __hv_var_k_f(VOf(Bf1), -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 0);
-    __hv_max_f(VIf(Bf0), VIf(Bf1), VOf(Bf1));
-    __hv_add_f(VIf(Bf1), VIf(O1), VOf(O1));
-    __hv_var_f(&_c->sVarf_6Oqkf, VOf(Bf1));
-    __hv_var_f(&_c->sVarf_1Mc26, VOf(Bf0));
-    __hv_mul_f(VIf(I0), VIf(Bf0), VOf(Bf0));
-    __hv_fma_f(VIf(I2), VIf(Bf1), VIf(Bf0), VOf(Bf0));
-    __hv_var_k_f(VOf(Bf1), 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0);
-    __hv_min_f(VIf(Bf0), VIf(Bf1), VOf(Bf1));
-    __hv_var_k_f(VOf(Bf0), -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 0);
-    __hv_max_f(VIf(Bf1), VIf(Bf0), VOf(Bf0));
-    __hv_add_f(VIf(Bf0), VIf(O0), VOf(O0));
-
-    // save output vars to output buffer
-    __hv_store_f(outputBuffers[0]+n, VIf(O0));
-    __hv_store_f(outputBuffers[1]+n, VIf(O1));
+    // run the signal graph without interruption up to the next scheduled message
+    const int nb = n + ctx_getSubBlockSize(Base(_c), nextBlock, n4-n);
+    nextBlock += nb - n;
+
+    // keep signal object state local to the sub-block
+    SignalVarf sVarf_KrQSd = _c->sVarf_KrQSd;
+    SignalVarf sVarf_kOnKw = _c->sVarf_kOnKw;
+    SignalVarf sVarf_6Oqkf = _c->sVarf_6Oqkf;
+    SignalVarf sVarf_1Mc26 = _c->sVarf_1Mc26;
+
+    for (; n < nb; n += HV_N_SIMD) {
+
+      // load input buffers
+      __hv_load_f(inputBuffers[0]+n, VOf(I0));
+      __hv_load_f(inputBuffers[1]+n, VOf(I1));
+      __hv_load_f(inputBuffers[2]+n, VOf(I2));
+      __hv_load_f(inputBuffers[3]+n, VOf(I3));
+
+      // zero output buffers
+      __hv_zero_f(VOf(O0));
+      __hv_zero_f(VOf(O1));
+
+      // process all signal functions
+      __hv_var_f(&sVarf_KrQSd, VOf(Bf0));
+      __hv_var_f(&sVarf_kOnKw, VOf(Bf1));
+      __hv_mul_f(VIf(I1), VIf(Bf1), VOf(Bf1));
+      __hv_fma_f(VIf(I3), VIf(Bf0), VIf(Bf1), VOf(Bf1));
+      __hv_min_f(VIf(Bf1), VIf(K0), VOf(Bf0));
+      __hv_max_f(VIf(Bf0), VIf(K1), VOf(Bf1));
+      __hv_add_f(VIf(Bf1), VIf(O1), VOf(O1));
+      __hv_var_f(&sVarf_6Oqkf, VOf(Bf1));
+      __hv_var_f(&sVarf_1Mc26, VOf(Bf0));
+      __hv_mul_f(VIf(I0), VIf(Bf0), VOf(Bf0));
+      __hv_fma_f(VIf(I2), VIf(Bf1), VIf(Bf0), VOf(Bf0));
+      __hv_min_f(VIf(Bf0), VIf(K0), VOf(Bf1));
+      __hv_max_f(VIf(Bf1), VIf(K1), VOf(Bf0));
+      __hv_add_f(VIf(Bf0), VIf(O0), VOf(O0));
+
+      // save output vars to output buffer
+      __hv_store_f(outputBuffers[0]+n, VIf(O0));
+      __hv_store_f(outputBuffers[1]+n, VIf(O1));
+    }
+
+    // write back signal object state
+    _c->sVarf_KrQSd = sVarf_KrQSd;
+    _c->sVarf_kOnKw = sVarf_kOnKw;
+    _c->sVarf_6Oqkf = sVarf_6Oqkf;
+    _c->sVarf_1Mc26 = sVarf_1Mc26;
   }
 
   Base(_c)->blockStartTimestamp = nextBlock;
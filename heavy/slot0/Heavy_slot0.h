@@ -187,12 +187,38 @@ void hv_cancelMessage(Heavy *c, HvMessage *m);
 /** Returns a table object given its name. NULL if no table with that name exists. */
 struct HvTable *hv_getTableForName(Heavy *c, const char *tableName);
 
+/**
+ * Replaces the contents of a table without blocking the audio thread. A copy of
+ * the data is prepared in an aligned buffer on the calling thread, and is swapped
+ * in at the start of the next processed block. The replaced buffer is freed by
+ * hv_collectTables(), the next call, or when the patch is freed. Contents which
+ * have not been swapped in yet are replaced. Only one thread may load tables.
+ * Returns the number of bytes allocated, or zero if the table does not exist or
+ * the length is not that of the table, as only its contents can be replaced.
+ */
+unsigned int hv_publishTable(Heavy *c, const char *tableName, const float *data, unsigned int length);
+
+/**
+ * Frees the table buffers which have been replaced since the last call. Call it
+ * from the thread which publishes tables, so that old contents are not held
+ * until the next publish.
+ */
+void hv_collectTables(Heavy *c);
+
 /** Returns the current patch time in milliseconds. */
 double hv_getCurrentTime(Heavy *c);
 
 /** Returns the current patch time in samples. This value is always exact. */
 unsigned int hv_getCurrentSample(Heavy *c);
 
+/**
+ * Advances the patch time by a block of n samples without running the signal graph,
+ * in place of a process call whose output is known to be silent. Returns the number
+ * of samples skipped, or 0 if a message is due within the block. In that case nothing
+ * is done and the patch must be processed as usual.
+ */
+int hv_skipBlock(Heavy *c, int n);
+
 /** Sets a user-definable value. This value is never manipulated by Heavy. */
 void hv_setUserData(Heavy *c, void *userData);
 
@@ -87,6 +87,8 @@ HV_EXPORT Hv_slot0 *hv_slot0_new_with_options(double sampleRate, int poolKb) {
   Base(_c)->blockStartTimestamp = 0;
   Base(_c)->f_scheduleMessageForReceiver = &ctx_intern_scheduleMessageForReceiver;
   Base(_c)->f_getTableForHash = &ctx_intern_getTableForHash;
+  Base(_c)->pendingTables = NULL;
+  Base(_c)->retiredTables = NULL;
   mq_initWithPoolSize(&Base(_c)->mq, poolKb);
   Base(_c)->basePath = NULL;
   Base(_c)->printHook = NULL;
@@ -97,6 +99,7 @@ HV_EXPORT Hv_slot0 *hv_slot0_new_with_options(double sampleRate, int poolKb) {
   Base(_c)->numBytes = sizeof(Hv_slot0);
   Base(_c)->numBytes += sLine_init(&_c->sLine_l1tZU);
   Base(_c)->numBytes += sPhasor_init(&_c->sPhasor_o7ys3, sampleRate);
+  Base(_c)->numBytes += sWavetable_init(&_c->sWavetable_o7ys3, HV_WAVETABLE_COS, sampleRate);
   Base(_c)->numBytes += sLine_init(&_c->sLine_VHntj);
   Base(_c)->numBytes += cSlice_init(&_c->cSlice_v9LOk, 0, 1);
   Base(_c)->numBytes += cSlice_init(&_c->cSlice_hFC8p, 4, 1);
@@ -114,6 +117,7 @@ HV_EXPORT Hv_slot0 *hv_slot0_new(double sampleRate) {
 }
 
 HV_EXPORT void hv_slot0_free(Hv_slot0 *_c) {
+  sWavetable_free(&_c->sWavetable_o7ys3);
 
   hv_free(Base(_c)->basePath);
   mq_free(&Base(_c)->mq); // free queue after all objects have been freed, messages may be cancelled
@@ -269,8 +273,11 @@ extern "C" {
 HV_EXPORT int hv_slot0_process(Hv_slot0 *const _c, float **const inputBuffers, float **const outputBuffers, int nx) {
   const int n4 = nx & ~HV_N_SIMD_MASK; // ensure that the block size is a multiple of HV_N_SIMD
 
+  // swap in the tables loaded by other threads
+  ctx_updateTables(Base(_c));
+
   // temporary signal vars
-  hv_bufferf_t Bf0, Bf1, Bf2, Bf3, Bf4;
+  hv_bufferf_t Bf0, Bf1;
 
   // input and output vars
   hv_bufferf_t O0, O1;
@@ -279,48 +286,49 @@ HV_EXPORT int hv_slot0_process(Hv_slot0 *const _c, float **const inputBuffers, f
   hv_bufferf_t ZERO; __hv_zero_f(VOf(ZERO));
 
   hv_uint32_t nextBlock = Base(_c)->blockStartTimestamp;
-  for (int n = 0; n < n4; n += HV_N_SIMD) {
+  for (int n = 0; n < n4;) {
 
     // process all of the messages for this block
-    nextBlock += HV_N_SIMD;
-    while (mq_hasMessageBefore(&Base(_c)->mq, nextBlock)) {
+    while (mq_hasMessageBefore(&Base(_c)->mq, nextBlock+HV_N_SIMD)) {
       MessageNode *const node = mq_peek(&Base(_c)->mq);
       node->sendMessage(Base(_c), node->let, node->m);
       mq_pop(&Base(_c)->mq);
     }
 
-    
-
-    // zero output buffers
-    __hv_zero_f(VOf(O0));
-    __hv_zero_f(VOf(O1));
-
-    // process all signal functions
-    __hv_line_f(&_c->sLine_l1tZU, VOf(Bf0));
-    __hv_phasor_f(&_c->sPhasor_o7ys3, VIf(Bf0), VOf(Bf0));
-    __hv_var_k_f(VOf(Bf1), 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0);
-    __hv_sub_f(VIf(Bf0), VIf(Bf1), VOf(Bf1));
-    __hv_abs_f(VIf(Bf1), VOf(Bf1));
-    __hv_var_k_f(VOf(Bf0), 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0);
-    __hv_sub_f(VIf(Bf1), VIf(Bf0), VOf(Bf0));
-    __hv_var_k_f(VOf(Bf1), 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 0);
-    __hv_mul_f(VIf(Bf0), VIf(Bf1), VOf(Bf1));
-    __hv_mul_f(VIf(Bf1), VIf(Bf1), VOf(Bf0));
-    __hv_mul_f(VIf(Bf1), VIf(Bf0), VOf(Bf2));
-    __hv_mul_f(VIf(Bf2), VIf(Bf0), VOf(Bf0));
-    __hv_var_k_f(VOf(Bf3), 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0);
-    __hv_var_k_f(VOf(Bf4), 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0);
-    __hv_mul_f(VIf(Bf2), VIf(Bf4), VOf(Bf4));
-    __hv_sub_f(VIf(Bf1), VIf(Bf4), VOf(Bf4));
-    __hv_fma_f(VIf(Bf0), VIf(Bf3), VIf(Bf4), VOf(Bf4));
-    __hv_line_f(&_c->sLine_VHntj, VOf(Bf3));
-    __hv_mul_f(VIf(Bf4), VIf(Bf3), VOf(Bf3));
-    __hv_add_f(VIf(Bf3), VIf(O1), VOf(O1));
-    __hv_add_f(VIf(Bf3), VIf(O0), VOf(O0));
-
-    // save output vars to output buffer
-    __hv_store_f(outputBuffers[0]+n, VIf(O0));
-    __hv_store_f(outputBuffers[1]+n, VIf(O1));
+    // run the signal graph without interruption up to the next scheduled message
+    const int nb = n + ctx_getSubBlockSize(Base(_c), nextBlock, n4-n);
+    nextBlock += nb - n;
+
+    // keep signal object state local to the sub-block
+    SignalLine sLine_l1tZU = _c->sLine_l1tZU;
+    SignalPhasor sPhasor_o7ys3 = _c->sPhasor_o7ys3;
+    SignalWavetable sWavetable_o7ys3 = _c->sWavetable_o7ys3;
+    SignalLine sLine_VHntj = _c->sLine_VHntj;
+
+    for (; n < nb; n += HV_N_SIMD) {
+
+      // zero output buffers
+      __hv_zero_f(VOf(O0));
+      __hv_zero_f(VOf(O1));
+
+      // process all signal functions
+      __hv_line_f(&sLine_l1tZU, VOf(Bf0));
+      __hv_phasor_f(&sPhasor_o7ys3, VIf(Bf0), VOf(Bf1));
+      __hv_wavetable_f(&sWavetable_o7ys3, VIf(Bf1), VIf(Bf0), VOf(Bf1));
+      __hv_line_f(&sLine_VHntj, VOf(Bf0));
+      __hv_mul_f(VIf(Bf1), VIf(Bf0), VOf(Bf1));
+      __hv_add_f(VIf(Bf1), VIf(O1), VOf(O1));
+      __hv_add_f(VIf(Bf1), VIf(O0), VOf(O0));
+
+      // save output vars to output buffer
+      __hv_store_f(outputBuffers[0]+n, VIf(O0));
+      __hv_store_f(outputBuffers[1]+n, VIf(O1));
+    }
+
+    // write back signal object state
+    _c->sLine_l1tZU = sLine_l1tZU;
+    _c->sPhasor_o7ys3 = sPhasor_o7ys3;
+    _c->sLine_VHntj = sLine_VHntj;
   }
 
   Base(_c)->blockStartTimestamp = nextBlock;
@@ -37,6 +37,7 @@
 #include "SignalLine.h"
 #include "HvMath.h"
 #include "SignalPhasor.h"
+#include "SignalWavetable.h"
 
 typedef struct Hv_slot0 {
   HvBase base;
@@ -44,6 +45,7 @@ typedef struct Hv_slot0 {
   // objects
   SignalLine sLine_l1tZU;
   SignalPhasor sPhasor_o7ys3;
+  SignalWavetable sWavetable_o7ys3;
   SignalLine sLine_VHntj;
   ControlSlice cSlice_v9LOk;
   ControlSlice cSlice_hFC8p;
@@ -122,6 +122,8 @@ HV_EXPORT Hv_slot1 *hv_slot1_new_with_options(double sampleRate, int poolKb) {
   Base(_c)->blockStartTimestamp = 0;
   Base(_c)->f_scheduleMessageForReceiver = &ctx_intern_scheduleMessageForReceiver;
   Base(_c)->f_getTableForHash = &ctx_intern_getTableForHash;
+  Base(_c)->pendingTables = NULL;
+  Base(_c)->retiredTables = NULL;
   mq_initWithPoolSize(&Base(_c)->mq, poolKb);
   Base(_c)->basePath = NULL;
   Base(_c)->printHook = NULL;
@@ -131,12 +133,15 @@ HV_EXPORT Hv_slot1 *hv_slot1_new_with_options(double sampleRate, int poolKb) {
 
   Base(_c)->numBytes = sizeof(Hv_slot1);
   Base(_c)->numBytes += sPhasor_k_init(&_c->sPhasor_JfQn8, 0.0f, sampleRate);
+  Base(_c)->numBytes += sWavetable_init(&_c->sWavetable_JfQn8, HV_WAVETABLE_COS, sampleRate);
   Base(_c)->numBytes += sLine_init(&_c->sLine_O0Rar);
   Base(_c)->numBytes += sVarf_init(&_c->sVarf_rn0b3, 0.0f, 0.0f, false);
   Base(_c)->numBytes += sPhasor_k_init(&_c->sPhasor_2Bnwz, 0.0f, sampleRate);
+  Base(_c)->numBytes += sWavetable_init(&_c->sWavetable_2Bnwz, HV_WAVETABLE_COS, sampleRate);
   Base(_c)->numBytes += sVarf_init(&_c->sVarf_PcvAb, 0.0f, 0.0f, false);
   Base(_c)->numBytes += sVarf_init(&_c->sVarf_d9lws, 0.0f, 0.0f, false);
   Base(_c)->numBytes += sPhasor_k_init(&_c->sPhasor_qLhCd, 0.0f, sampleRate);
+  Base(_c)->numBytes += sWavetable_init(&_c->sWavetable_qLhCd, HV_WAVETABLE_COS, sampleRate);
   Base(_c)->numBytes += sVarf_init(&_c->sVarf_8lkZJ, 0.0f, 0.0f, false);
   Base(_c)->numBytes += cBinop_init(&_c->cBinop_ZsvrY, 1.0f); // __pow
   Base(_c)->numBytes += cPack_init(&_c->cPack_kgGkd, 2);
@@ -163,6 +168,9 @@ HV_EXPORT Hv_slot1 *hv_slot1_new(double sampleRate) {
 }
 
 HV_EXPORT void hv_slot1_free(Hv_slot1 *_c) {
+  sWavetable_free(&_c->sWavetable_JfQn8);
+  sWavetable_free(&_c->sWavetable_2Bnwz);
+  sWavetable_free(&_c->sWavetable_qLhCd);
   cPack_free(&_c->cPack_kgGkd);
 
   hv_free(Base(_c)->basePath);
@@ -436,8 +444,11 @@ extern "C" {
 HV_EXPORT int hv_slot1_process(Hv_slot1 *const _c, float **const inputBuffers, float **const outputBuffers, int nx) {
   const int n4 = nx & ~HV_N_SIMD_MASK; // ensure that the block size is a multiple of HV_N_SIMD
 
+  // swap in the tables loaded by other threads
+  ctx_updateTables(Base(_c));
+
   // temporary signal vars
-  hv_bufferf_t Bf0, Bf1, Bf2, Bf3, Bf4, Bf5, Bf6;
+  hv_bufferf_t Bf0, Bf2, Bf3, Bf4, Bf5, Bf6;
 
   // input and output vars
   hv_bufferf_t O0, O1;
@@ -446,89 +457,74 @@ HV_EXPORT int hv_slot1_process(Hv_slot1 *const _c, float **const inputBuffers, f
   hv_bufferf_t ZERO; __hv_zero_f(VOf(ZERO));
 
   hv_uint32_t nextBlock = Base(_c)->blockStartTimestamp;
-  for (int n = 0; n < n4; n += HV_N_SIMD) {
+  for (int n = 0; n < n4;) {
 
     // process all of the messages for this block
-    nextBlock += HV_N_SIMD;
-    while (mq_hasMessageBefore(&Base(_c)->mq, nextBlock)) {
+    while (mq_hasMessageBefore(&Base(_c)->mq, nextBlock+HV_N_SIMD)) {
       MessageNode *const node = mq_peek(&Base(_c)->mq);
       node->sendMessage(Base(_c), node->let, node->m);
       mq_pop(&Base(_c)->mq);
     }
 
-    
-
-    // zero output buffers
-    __hv_zero_f(VOf(O0));
-    __hv_zero_f(VOf(O1));
-
-    // process all signal functions
-    __hv_phasor_k_f(&_c->sPhasor_JfQn8, VOf(Bf0));
-    __hv_var_k_f(VOf(Bf1), 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0);
-    __hv_sub_f(VIf(Bf0), VIf(Bf1), VOf(Bf1));
-    __hv_abs_f(VIf(Bf1), VOf(Bf1));
-    __hv_var_k_f(VOf(Bf0), 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0);
-    __hv_sub_f(VIf(Bf1), VIf(Bf0), VOf(Bf0));
-    __hv_var_k_f(VOf(Bf1), 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 0);
-    __hv_mul_f(VIf(Bf0), VIf(Bf1), VOf(Bf1));
-    __hv_mul_f(VIf(Bf1), VIf(Bf1), VOf(Bf0));
-    __hv_mul_f(VIf(Bf1), VIf(Bf0), VOf(Bf2));
-    __hv_mul_f(VIf(Bf2), VIf(Bf0), VOf(Bf0));
-    __hv_var_k_f(VOf(Bf3), 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0);
-    __hv_var_k_f(VOf(Bf4), 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0);
-    __hv_mul_f(VIf(Bf2), VIf(Bf4), VOf(Bf4));
-    __hv_sub_f(VIf(Bf1), VIf(Bf4), VOf(Bf4));
-    __hv_fma_f(VIf(Bf0), VIf(Bf3), VIf(Bf4), VOf(Bf4));
-    __hv_line_f(&_c->sLine_O0Rar, VOf(Bf3));
-    __hv_mul_f(VIf(Bf4), VIf(Bf3), VOf(Bf4));
-    __hv_var_f(&_c->sVarf_rn0b3, VOf(Bf0));
-    __hv_mul_f(VIf(Bf4), VIf(Bf0), VOf(Bf0));
-    __hv_phasor_k_f(&_c->sPhasor_2Bnwz, VOf(Bf4));
-    __hv_var_k_f(VOf(Bf1), 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0);
-    __hv_sub_f(VIf(Bf4), VIf(Bf1), VOf(Bf1));
-    __hv_abs_f(VIf(Bf1), VOf(Bf1));
-    __hv_var_k_f(VOf(Bf4), 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0);
-    __hv_sub_f(VIf(Bf1), VIf(Bf4), VOf(Bf4));
-    __hv_var_k_f(VOf(Bf1), 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 0);
-    __hv_mul_f(VIf(Bf4), VIf(Bf1), VOf(Bf1));
-    __hv_mul_f(VIf(Bf1), VIf(Bf1), VOf(Bf4));
-    __hv_mul_f(VIf(Bf1), VIf(Bf4), VOf(Bf2));
-    __hv_mul_f(VIf(Bf2), VIf(Bf4), VOf(Bf4));
-    __hv_var_k_f(VOf(Bf5), 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0);
-    __hv_var_k_f(VOf(Bf6), 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0);
-    __hv_mul_f(VIf(Bf2), VIf(Bf6), VOf(Bf6));
-    __hv_sub_f(VIf(Bf1), VIf(Bf6), VOf(Bf6));
-    __hv_fma_f(VIf(Bf4), VIf(Bf5), VIf(Bf6), VOf(Bf6));
-    __hv_var_f(&_c->sVarf_PcvAb, VOf(Bf5));
-    __hv_var_f(&_c->sVarf_d9lws, VOf(Bf4));
-    __hv_fma_f(VIf(Bf6), VIf(Bf5), VIf(Bf4), VOf(Bf4));
-    __hv_mul_f(VIf(Bf0), VIf(Bf4), VOf(Bf0));
-    __hv_add_f(VIf(Bf0), VIf(O0), VOf(O0));
-    __hv_phasor_k_f(&_c->sPhasor_qLhCd, VOf(Bf0));
-    __hv_var_k_f(VOf(Bf5), 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0);
-    __hv_sub_f(VIf(Bf0), VIf(Bf5), VOf(Bf5));
-    __hv_abs_f(VIf(Bf5), VOf(Bf5));
-    __hv_var_k_f(VOf(Bf0), 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f, 0);
-    __hv_sub_f(VIf(Bf5), VIf(Bf0), VOf(Bf0));
-    __hv_var_k_f(VOf(Bf5), 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 6.28319f, 0);
-    __hv_mul_f(VIf(Bf0), VIf(Bf5), VOf(Bf5));
-    __hv_mul_f(VIf(Bf5), VIf(Bf5), VOf(Bf0));
-    __hv_mul_f(VIf(Bf5), VIf(Bf0), VOf(Bf6));
-    __hv_mul_f(VIf(Bf6), VIf(Bf0), VOf(Bf0));
-    __hv_var_k_f(VOf(Bf1), 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0.00784314f, 0);
-    __hv_var_k_f(VOf(Bf2), 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0.166667f, 0);
-    __hv_mul_f(VIf(Bf6), VIf(Bf2), VOf(Bf2));
-    __hv_sub_f(VIf(Bf5), VIf(Bf2), VOf(Bf2));
-    __hv_fma_f(VIf(Bf0), VIf(Bf1), VIf(Bf2), VOf(Bf2));
-    __hv_mul_f(VIf(Bf2), VIf(Bf3), VOf(Bf3));
-    __hv_var_f(&_c->sVarf_8lkZJ, VOf(Bf2));
-    __hv_mul_f(VIf(Bf3), VIf(Bf2), VOf(Bf2));
-    __hv_mul_f(VIf(Bf2), VIf(Bf4), VOf(Bf4));
-    __hv_add_f(VIf(Bf4), VIf(O1), VOf(O1));
-
-    // save output vars to output buffer
-    __hv_store_f(outputBuffers[0]+n, VIf(O0));
-    __hv_store_f(outputBuffers[1]+n, VIf(O1));
+    // run the signal graph without interruption up to the next scheduled message
+    const int nb = n + ctx_getSubBlockSize(Base(_c), nextBlock, n4-n);
+    nextBlock += nb - n;
+
+    // keep signal object state local to the sub-block
+    SignalPhasor sPhasor_JfQn8 = _c->sPhasor_JfQn8;
+    SignalWavetable sWavetable_JfQn8 = _c->sWavetable_JfQn8;
+    SignalLine sLine_O0Rar = _c->sLine_O0Rar;
+    SignalVarf sVarf_rn0b3 = _c->sVarf_rn0b3;
+    SignalPhasor sPhasor_2Bnwz = _c->sPhasor_2Bnwz;
+    SignalWavetable sWavetable_2Bnwz = _c->sWavetable_2Bnwz;
+    SignalVarf sVarf_PcvAb = _c->sVarf_PcvAb;
+    SignalVarf sVarf_d9lws = _c->sVarf_d9lws;
+    SignalPhasor sPhasor_qLhCd = _c->sPhasor_qLhCd;
+    SignalWavetable sWavetable_qLhCd = _c->sWavetable_qLhCd;
+    SignalVarf sVarf_8lkZJ = _c->sVarf_8lkZJ;
+
+    for (; n < nb; n += HV_N_SIMD) {
+
+      // zero output buffers
+      __hv_zero_f(VOf(O0));
+      __hv_zero_f(VOf(O1));
+
+      // process all signal functions
+      __hv_phasor_k_f(&sPhasor_JfQn8, VOf(Bf0));
+      __hv_wavetable_f(&sWavetable_JfQn8, VIf(Bf0), VIf(ZERO), VOf(Bf4));
+      __hv_line_f(&sLine_O0Rar, VOf(Bf3));
+      __hv_mul_f(VIf(Bf4), VIf(Bf3), VOf(Bf4));
+      __hv_var_f(&sVarf_rn0b3, VOf(Bf0));
+      __hv_mul_f(VIf(Bf4), VIf(Bf0), VOf(Bf0));
+      __hv_phasor_k_f(&sPhasor_2Bnwz, VOf(Bf4));
+      __hv_wavetable_f(&sWavetable_2Bnwz, VIf(Bf4), VIf(ZERO), VOf(Bf6));
+      __hv_var_f(&sVarf_PcvAb, VOf(Bf5));
+      __hv_var_f(&sVarf_d9lws, VOf(Bf4));
+      __hv_fma_f(VIf(Bf6), VIf(Bf5), VIf(Bf4), VOf(Bf4));
+      __hv_mul_f(VIf(Bf0), VIf(Bf4), VOf(Bf0));
+      __hv_add_f(VIf(Bf0), VIf(O0), VOf(O0));
+      __hv_phasor_k_f(&sPhasor_qLhCd, VOf(Bf0));
+      __hv_wavetable_f(&sWavetable_qLhCd, VIf(Bf0), VIf(ZERO), VOf(Bf2));
+      __hv_mul_f(VIf(Bf2), VIf(Bf3), VOf(Bf3));
+      __hv_var_f(&sVarf_8lkZJ, VOf(Bf2));
+      __hv_mul_f(VIf(Bf3), VIf(Bf2), VOf(Bf2));
+      __hv_mul_f(VIf(Bf2), VIf(Bf4), VOf(Bf4));
+      __hv_add_f(VIf(Bf4), VIf(O1), VOf(O1));
+
+      // save output vars to output buffer
+      __hv_store_f(outputBuffers[0]+n, VIf(O0));
+      __hv_store_f(outputBuffers[1]+n, VIf(O1));
+    }
+
+    // write back signal object state
+    _c->sPhasor_JfQn8 = sPhasor_JfQn8;
+    _c->sLine_O0Rar = sLine_O0Rar;
+    _c->sVarf_rn0b3 = sVarf_rn0b3;
+    _c->sPhasor_2Bnwz = sPhasor_2Bnwz;
+    _c->sVarf_PcvAb = sVarf_PcvAb;
+    _c->sVarf_d9lws = sVarf_d9lws;
+    _c->sPhasor_qLhCd = sPhasor_qLhCd;
+    _c->sVarf_8lkZJ = sVarf_8lkZJ;
   }
 
   Base(_c)->blockStartTimestamp = nextBlock;
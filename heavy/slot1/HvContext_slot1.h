@@ -40,6 +40,7 @@
 #include "ControlDelay.h"
 #include "HvMath.h"
 #include "SignalPhasor.h"
+#include "SignalWavetable.h"
 #include "ControlPack.h"
 
 typedef struct Hv_slot1 {
@@ -47,12 +48,15 @@ typedef struct Hv_slot1 {
 
   // objects
   SignalPhasor sPhasor_JfQn8;
+  SignalWavetable sWavetable_JfQn8;
   SignalLine sLine_O0Rar;
   SignalVarf sVarf_rn0b3;
   SignalPhasor sPhasor_2Bnwz;
+  SignalWavetable sWavetable_2Bnwz;
   SignalVarf sVarf_PcvAb;
   SignalVarf sVarf_d9lws;
   SignalPhasor sPhasor_qLhCd;
+  SignalWavetable sWavetable_qLhCd;
   SignalVarf sVarf_8lkZJ;
   ControlBinop cBinop_UtxaQ;
   ControlBinop cBinop_ZsvrY;
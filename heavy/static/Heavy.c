@@ -219,6 +219,16 @@ HV_EXPORT HvTable *hv_getTableForName(HvBase *c, const char *tableName) {
   return ctx_getTableForName(c, tableName);
 }
 
+HV_EXPORT hv_size_t hv_publishTable(HvBase *c, const char *tableName,
+    const float *data, hv_uint32_t length) {
+  HvTable *o = ctx_getTableForName(c, tableName);
+  return (o != NULL) ? ctx_publishTable(c, o, data, length) : 0;
+}
+
+HV_EXPORT void hv_collectTables(HvBase *c) {
+  ctx_collectTables(c);
+}
+
 HV_EXPORT void hv_cancelMessage(HvBase *c, HvMessage *m) {
   ctx_cancelMessage(c, m, NULL);
 }
@@ -231,6 +241,13 @@ HV_EXPORT hv_uint32_t hv_getCurrentSample(HvBase *c) {
   return c->blockStartTimestamp;
 }
 
+HV_EXPORT int hv_skipBlock(HvBase *c, int nx) {
+  const int n4 = nx & ~HV_N_SIMD_MASK;
+  if (mq_hasMessageBefore(&c->mq, c->blockStartTimestamp + n4)) return 0;
+  c->blockStartTimestamp += n4;
+  return n4;
+}
+
 HV_EXPORT void *hv_getUserData(HvBase *c) {
   return ctx_getUserData(c);
 }
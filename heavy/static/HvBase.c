@@ -15,6 +15,7 @@
  */
 
 #include "HvBase.h"
+#include "HvTable.h"
 
 void ctx_setBasePath(HvBase *const _c, const char *basePath) {
   hv_free(_c->basePath);
@@ -25,6 +26,54 @@ void ctx_setBasePath(HvBase *const _c, const char *basePath) {
   }
 }
 
+static void ctx_pushPendingTable(HvBase *const _c, HvTable *o) {
+  HvTable *head = NULL;
+  do {
+    head = (HvTable *) hv_atomic_load_ptr(&_c->pendingTables);
+    o->nextPending = head;
+  } while (!hv_atomic_cas_ptr(&_c->pendingTables, head, o));
+}
+
+static void ctx_pushRetiredTable(HvBase *const _c, HvTable *o) {
+  HvTable *head = NULL;
+  do {
+    head = (HvTable *) hv_atomic_load_ptr(&_c->retiredTables);
+    o->nextRetired = head;
+  } while (!hv_atomic_cas_ptr(&_c->retiredTables, head, o));
+}
+
+hv_size_t ctx_publishTable(HvBase *const _c, HvTable *o,
+    const float *data, hv_uint32_t length) {
+  ctx_collectTables(_c); // so that the table can be swapped again
+  bool wasPending = false;
+  const hv_size_t numBytes = hTable_publish(o, data, length, &wasPending);
+  // the table is in the list for as long as its buffer is pending, and only once
+  if (numBytes > 0 && !wasPending) ctx_pushPendingTable(_c, o);
+  return numBytes;
+}
+
+void ctx_updatePendingTables(HvBase *const _c) {
+  HvTable *o = (HvTable *) hv_atomic_exchange_ptr(&_c->pendingTables, NULL);
+  while (o != NULL) {
+    // the loader may publish again as soon as the table is updated
+    HvTable *next = o->nextPending;
+    if (hTable_update(o)) ctx_pushRetiredTable(_c, o);
+    else ctx_pushPendingTable(_c, o); // try again in the next block
+    o = next;
+  }
+}
+
+void ctx_collectTables(HvBase *const _c) {
+  // a table is only in the list once, as it cannot be swapped again until
+  // its retired buffer has been freed here
+  HvTable *o = (HvTable *) hv_atomic_exchange_ptr(&_c->retiredTables, NULL);
+  while (o != NULL) {
+    HvTable *next = o->nextRetired;
+    hTable_collect(o);
+    o = next;
+  }
+}
+
 void ctx_cancelMessage(HvBase *_c, HvMessage *m, void (*sendMessage)(HvBase *, int, const HvMessage *)) {
   mq_removeMessage(&_c->mq, m, sendMessage);
 }
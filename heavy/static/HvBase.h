@@ -29,6 +29,8 @@ typedef struct HvBase {
   hv_size_t numBytes; // the total number of bytes allocated for this patch
   void (*f_scheduleMessageForReceiver)(struct HvBase *const, const char *, HvMessage *);
   struct HvTable *(*f_getTableForHash)(struct HvBase *const, hv_uint32_t);
+  struct HvTable *pendingTables; // tables with a buffer published by another thread
+  struct HvTable *retiredTables; // tables with a buffer replaced by the audio thread
   MessageQueue mq;
   void (*printHook)(double, const char *, const char *, void *);
   void (*sendHook)(double, const char *, const HvMessage *const, void *);
@@ -77,6 +79,23 @@ static inline int ctx_getNumOutputChannels(HvBase *_c) {
   return _c->numOutputChannels;
 }
 
+/**
+ * Publishes new contents for a table from a loader thread, to be swapped in
+ * at the start of the next block. See hTable_publish().
+ */
+hv_size_t ctx_publishTable(HvBase *const _c, struct HvTable *o,
+    const float *data, hv_uint32_t length);
+
+/** Frees the table buffers replaced since the last call, on the loader thread. */
+void ctx_collectTables(HvBase *const _c);
+
+void ctx_updatePendingTables(HvBase *const _c);
+
+/** Swaps in the buffers published since the last block. Called by the audio thread. */
+static inline void ctx_updateTables(HvBase *const _c) {
+  if (hv_atomic_load_ptr(&_c->pendingTables) != NULL) ctx_updatePendingTables(_c);
+}
+
 static inline const char *ctx_getName(HvBase *_c) {
   return _c->name;
 }
@@ -86,6 +105,22 @@ static inline hv_uint32_t ctx_getBlockStartTimestamp(HvBase *_c) {
   return _c->blockStartTimestamp;
 }
 
+/**
+ * Returns the number of samples, a multiple of HV_N_SIMD and at most n, which can be
+ * processed from timestamp before the next scheduled message is due. Messages before
+ * timestamp+HV_N_SIMD must already have been delivered. Building with
+ * HV_PROCESS_PER_VECTOR restores the old schedule of one message check per vector.
+ */
+static inline int ctx_getSubBlockSize(HvBase *const _c, const hv_uint32_t timestamp, const int n) {
+#if HV_PROCESS_PER_VECTOR
+  return HV_N_SIMD;
+#else
+  if (!mq_hasMessage(&_c->mq)) return n;
+  const hv_uint32_t d = msg_getTimestamp(mq_node_getMessage(mq_peek(&_c->mq))) - timestamp;
+  return (d < (hv_uint32_t) n) ? (int) (d & ~HV_N_SIMD_MASK) : n;
+#endif
+}
+
 static inline void ctx_setPrintHook(HvBase *const _c, void (*f)(double,
     const char *, const char *, void *)) {
   _c->printHook = f;
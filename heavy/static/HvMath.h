@@ -47,66 +47,82 @@ static inline void __hv_load_f(float *bIn, hv_bOutf_t bOut) {
 #endif
 }
 
-static inline void __hv_store_f(float *bOut, hv_bInf_t bIn) {
+// unaligned load
+static inline void __hv_loadu_f(const float *bIn, hv_bOutf_t bOut) {
 #if HV_SIMD_AVX
-  _mm256_store_ps(bOut, bIn);
+  *bOut = _mm256_loadu_ps(bIn);
 #elif HV_SIMD_SSE
-  _mm_store_ps(bOut, bIn);
+  *bOut = _mm_loadu_ps(bIn);
 #elif HV_SIMD_NEON
-  vst1q_f32(bOut, bIn);
+  *bOut = vld1q_f32(bIn);
 #else // HV_SIMD_NONE
-  *bOut = bIn;
+  *bOut = *bIn;
 #endif
 }
 
-static inline void __hv_log_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+static inline void __hv_store_f(float *bOut, hv_bInf_t bIn) {
 #if HV_SIMD_AVX
-#warning __hv_log_f() not implemented
+  _mm256_store_ps(bOut, bIn);
 #elif HV_SIMD_SSE
-#warning __hv_log_f() not implemented
+  _mm_store_ps(bOut, bIn);
 #elif HV_SIMD_NEON
-#warning __hv_log_f() not implemented
+  vst1q_f32(bOut, bIn);
 #else // HV_SIMD_NONE
-  *bOut = (bIn > 0.0f) ? hv_log_f(bIn) : 0.0f;
+  *bOut = bIn;
 #endif
 }
 
-static inline void __hv_log10_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+// returns a buffer with all elements set to k
+static inline hv_bufferf_t __hv_splat_f(const float k) {
 #if HV_SIMD_AVX
-#warning __hv_log10_f() not implemented
+  return _mm256_set1_ps(k);
 #elif HV_SIMD_SSE
-#warning __hv_log10_f() not implemented
+  return _mm_set1_ps(k);
 #elif HV_SIMD_NEON
-#warning __hv_log10_f() not implemented
+  return vdupq_n_f32(k);
 #else // HV_SIMD_NONE
-  *bOut = (bIn > 0.0f) ? hv_log10_f(bIn) : 0.0f;
+  return k;
 #endif
 }
 
-static inline void __hv_log2_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+// transposes HV_N_SIMD buffers in place, such that lane j of buffer i becomes lane i of buffer j
+static inline void __hv_transpose_f(hv_bufferf_t *b) {
 #if HV_SIMD_AVX
-#warning __hv_log2_f() not implemented
+  __m256 t0 = _mm256_unpacklo_ps(b[0], b[1]);
+  __m256 t1 = _mm256_unpackhi_ps(b[0], b[1]);
+  __m256 t2 = _mm256_unpacklo_ps(b[2], b[3]);
+  __m256 t3 = _mm256_unpackhi_ps(b[2], b[3]);
+  __m256 t4 = _mm256_unpacklo_ps(b[4], b[5]);
+  __m256 t5 = _mm256_unpackhi_ps(b[4], b[5]);
+  __m256 t6 = _mm256_unpacklo_ps(b[6], b[7]);
+  __m256 t7 = _mm256_unpackhi_ps(b[6], b[7]);
+  __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1,0,1,0));
+  __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3,2,3,2));
+  __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1,0,1,0));
+  __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3,2,3,2));
+  __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1,0,1,0));
+  __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3,2,3,2));
+  __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1,0,1,0));
+  __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3,2,3,2));
+  b[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+  b[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+  b[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+  b[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+  b[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+  b[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+  b[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+  b[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
 #elif HV_SIMD_SSE
-#warning __hv_log2_f() not implemented
+  _MM_TRANSPOSE4_PS(b[0], b[1], b[2], b[3]);
 #elif HV_SIMD_NEON
-#warning __hv_log2_f() not implemented
+  float32x4x2_t s = vtrnq_f32(b[0], b[1]);
+  float32x4x2_t t = vtrnq_f32(b[2], b[3]);
+  b[0] = vcombine_f32(vget_low_f32(s.val[0]), vget_low_f32(t.val[0]));
+  b[1] = vcombine_f32(vget_low_f32(s.val[1]), vget_low_f32(t.val[1]));
+  b[2] = vcombine_f32(vget_high_f32(s.val[0]), vget_high_f32(t.val[0]));
+  b[3] = vcombine_f32(vget_high_f32(s.val[1]), vget_high_f32(t.val[1]));
 #else // HV_SIMD_NONE
-  *bOut = (bIn > 0.0f) ? hv_log2_f(bIn) : 0.0f;
-#endif
-}
-
-// NOTE(mhroth): this is a pretty ghetto implementation
-static inline void __hv_cos_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
-#if HV_SIMD_AVX
-  *bOut = _mm256_set_ps(
-      hv_cos_f(bIn[7]), hv_cos_f(bIn[6]), hv_cos_f(bIn[5]), hv_cos_f(bIn[4]),
-      hv_cos_f(bIn[3]), hv_cos_f(bIn[2]), hv_cos_f(bIn[1]), hv_cos_f(bIn[0]));
-#elif HV_SIMD_SSE
-  *bOut = _mm_set_ps(hv_cos_f(bIn[3]), hv_cos_f(bIn[2]), hv_cos_f(bIn[1]), hv_cos_f(bIn[0]));
-#elif HV_SIMD_NEON
-  *bOut = (float32x4_t) {hv_cos_f(bIn[0]), hv_cos_f(bIn[1]), hv_cos_f(bIn[2]), hv_cos_f(bIn[3])};
-#else // HV_SIMD_NONE
-  *bOut = hv_cos_f(bIn);
+  (void) b; // a single lane is its own transpose
 #endif
 }
 
@@ -146,18 +162,6 @@ static inline void __hv_acosh_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
 #endif
 }
 
-static inline void __hv_sin_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
-#if HV_SIMD_AVX
-#warning __hv_sin_f() not implemented
-#elif HV_SIMD_SSE
-#warning __hv_sin_f() not implemented
-#elif HV_SIMD_NEON
-#warning __hv_sin_f() not implemented
-#else // HV_SIMD_NONE
-  *bOut = hv_sin_f(bIn);
-#endif
-}
-
 static inline void __hv_asin_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
 #if HV_SIMD_AVX
 #warning __hv_asin_f() not implemented
@@ -194,18 +198,6 @@ static inline void __hv_asinh_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
 #endif
 }
 
-static inline void __hv_tan_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
-#if HV_SIMD_AVX
-#warning __hv_tan_f() not implemented
-#elif HV_SIMD_SSE
-#warning __hv_tan_f() not implemented
-#elif HV_SIMD_NEON
-#warning __hv_tan_f() not implemented
-#else // HV_SIMD_NONE
-  *bOut = hv_tan_f(bIn);
-#endif
-}
-
 static inline void __hv_atan_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
 #if HV_SIMD_AVX
 #warning __hv_atan_f() not implemented
@@ -230,18 +222,6 @@ static inline void __hv_atan2_f(hv_bInf_t bIn0, hv_bInf_t bIn1, hv_bOutf_t bOut)
 #endif
 }
 
-static inline void __hv_tanh_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
-#if HV_SIMD_AVX
-#warning __hv_tanh_f() not implemented
-#elif HV_SIMD_SSE
-#warning __hv_tanh_f() not implemented
-#elif HV_SIMD_NEON
-#warning __hv_tanh_f() not implemented
-#else // HV_SIMD_NONE
-  *bOut = hv_tanh_f(bIn);
-#endif
-}
-
 static inline void __hv_atanh_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
 #if HV_SIMD_AVX
 #warning __hv_atanh_f() not implemented
@@ -293,18 +273,6 @@ static inline void __hv_abs_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
 #endif
 }
 
-static inline void __hv_exp_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
-#if HV_SIMD_AVX
-#warning __hv_exp_f() not implemented
-#elif HV_SIMD_SSE
-#warning __hv_exp_f() not implemented
-#elif HV_SIMD_NEON
-#warning __hv_exp_f() not implemented
-#else // HV_SIMD_NONE
-  *bOut = hv_exp_f(bIn);
-#endif
-}
-
 static inline void __hv_ceil_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
 #if HV_SIMD_AVX
   *bOut = _mm256_ceil_ps(bIn);
@@ -640,4 +608,371 @@ static inline void __hv_fma_f(hv_bInf_t bIn0, hv_bInf_t bIn1, hv_bInf_t bIn2, hv
 #endif
 }
 
+#if HV_APPLE
+#pragma mark - Exponential and Logarithm
+#endif
+
+// The SIMD exp and log kernels below are Cephes-style polynomial approximations
+// which never leave the vector registers. Max error measured against libm by
+// bench.c, built with -Ofast -ffast-math for SSE4.1, AVX and AVX2+FMA,
+// absolute where |f(x)| < 1 and relative otherwise:
+//   __hv_exp_f:   1 ulp (1.2e-7) over [-87.3, 88.3]
+//   __hv_log_f:   8.1e-8 for x in (0, FLT_MAX]
+//   __hv_log2_f:  1.3e-7
+//   __hv_log10_f: 1.4e-7
+// Out-of-range inputs are clamped. As with the scalar versions, log(x <= 0) == 0.
+
+// Keeps the compiler from reassociating floating point operations across this
+// point. Without FMA, __hv_fma_f is a separate multiply and add, which
+// -ffast-math would otherwise regroup, folding the parts of a split constant
+// back into one and losing the precision which the split is for.
+static inline void __hv_barrier_f(hv_bOutf_t b) {
+#if (defined(__GNUC__) || defined(__clang__)) && (HV_SIMD_AVX || HV_SIMD_SSE)
+  __asm__("" : "+x" (*b));
+#elif (defined(__GNUC__) || defined(__clang__)) && HV_SIMD_NEON
+  __asm__("" : "+w" (*b));
+#endif
+}
+
+// rounds to the nearest integer. Valid for |x| < 2^31.
+static inline void __hv_rint_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX
+  *bOut = _mm256_round_ps(bIn, (_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+#elif HV_SIMD_SSE
+  *bOut = _mm_round_ps(bIn, (_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+#elif HV_SIMD_NEON
+#if __ARM_ARCH >= 8
+  *bOut = vrndnq_f32(bIn);
+#else
+  // truncate x+0.5 and correct towards -inf where truncation rounded up
+  float32x4_t x = vaddq_f32(bIn, vdupq_n_f32(0.5f));
+  float32x4_t t = vcvtq_f32_s32(vcvtq_s32_f32(x));
+  *bOut = vsubq_f32(t, vreinterpretq_f32_u32(vandq_u32(
+      vcgtq_f32(t, x), vreinterpretq_u32_f32(vdupq_n_f32(1.0f)))));
+#endif
+#else // HV_SIMD_NONE
+  *bOut = hv_round_f(bIn);
+#endif
+}
+
+// splits a positive normal float into a mantissa in [0.5,1) and its exponent, as frexp()
+static inline void __hv_frexp_f(hv_bInf_t bIn, hv_bOutf_t bMant, hv_bOutf_t bExp) {
+#if HV_SIMD_AVX
+  // AVX has no 256-bit integer shift, but the masked exponent bits convert exactly to float
+  const __m256 e = _mm256_and_ps(bIn, _mm256_castsi256_ps(_mm256_set1_epi32(0x7F800000)));
+  *bExp = _mm256_sub_ps(
+      _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_castps_si256(e)), _mm256_set1_ps(1.0f/8388608.0f)),
+      _mm256_set1_ps(126.0f));
+  *bMant = _mm256_or_ps(_mm256_andnot_ps(
+      _mm256_castsi256_ps(_mm256_set1_epi32(0x7F800000)), bIn), _mm256_set1_ps(0.5f));
+#elif HV_SIMD_SSE
+  *bExp = _mm_cvtepi32_ps(_mm_sub_epi32(
+      _mm_srli_epi32(_mm_castps_si128(bIn), 23), _mm_set1_epi32(126)));
+  *bMant = _mm_or_ps(_mm_andnot_ps(
+      _mm_castsi128_ps(_mm_set1_epi32(0x7F800000)), bIn), _mm_set1_ps(0.5f));
+#elif HV_SIMD_NEON
+  const uint32x4_t i = vreinterpretq_u32_f32(bIn);
+  *bExp = vcvtq_f32_s32(vsubq_s32(
+      vreinterpretq_s32_u32(vshrq_n_u32(i, 23)), vdupq_n_s32(126)));
+  *bMant = vreinterpretq_f32_u32(vorrq_u32(
+      vandq_u32(i, vdupq_n_u32(0x807FFFFF)), vdupq_n_u32(0x3F000000)));
+#else // HV_SIMD_NONE
+  int e = 0;
+  *bMant = frexpf(bIn, &e);
+  *bExp = (float) e;
+#endif
+}
+
+// returns 2^n for integer-valued n in [-126, 127]
+static inline void __hv_exp2i_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX
+  // (n+127) << 23, computed exactly in the float domain
+  *bOut = _mm256_castsi256_ps(_mm256_cvttps_epi32(_mm256_mul_ps(
+      _mm256_add_ps(bIn, _mm256_set1_ps(127.0f)), _mm256_set1_ps(8388608.0f))));
+#elif HV_SIMD_SSE
+  *bOut = _mm_castsi128_ps(_mm_slli_epi32(
+      _mm_add_epi32(_mm_cvttps_epi32(bIn), _mm_set1_epi32(127)), 23));
+#elif HV_SIMD_NEON
+  *bOut = vreinterpretq_f32_s32(vshlq_n_s32(
+      vaddq_s32(vcvtq_s32_f32(bIn), vdupq_n_s32(127)), 23));
+#else // HV_SIMD_NONE
+  *bOut = ldexpf(1.0f, (int) bIn);
+#endif
+}
+
+static inline void __hv_exp_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX || HV_SIMD_SSE || HV_SIMD_NEON
+  hv_bufferf_t x, n, z, y;
+  __hv_max_f(bIn, __hv_splat_f(-87.33654f), &x); // keep 2^n normal
+  __hv_min_f(x, __hv_splat_f(88.37f), &x);
+
+  // exp(x) = 2^n * exp(r), |r| <= ln(2)/2
+  __hv_mul_f(x, __hv_splat_f(1.44269504088896341f), &n);
+  __hv_rint_f(n, &n);
+  __hv_fma_f(n, __hv_splat_f(-0.693359375f), x, &x); // ln(2) in two parts, for extra precision
+  __hv_barrier_f(&x);
+  __hv_fma_f(n, __hv_splat_f(2.12194440e-4f), x, &x);
+  __hv_barrier_f(&x);
+
+  __hv_mul_f(x, x, &z);
+  __hv_fma_f(x, __hv_splat_f(1.9875691500e-4f), __hv_splat_f(1.3981999507e-3f), &y);
+  __hv_fma_f(y, x, __hv_splat_f(8.3334519073e-3f), &y);
+  __hv_fma_f(y, x, __hv_splat_f(4.1665795894e-2f), &y);
+  __hv_fma_f(y, x, __hv_splat_f(1.6666665459e-1f), &y);
+  __hv_fma_f(y, x, __hv_splat_f(5.0000001201e-1f), &y);
+  __hv_fma_f(y, z, x, &y);
+  __hv_add_f(y, __hv_splat_f(1.0f), &y);
+
+  __hv_exp2i_f(n, &n);
+  __hv_mul_f(y, n, bOut);
+#else // HV_SIMD_NONE
+  *bOut = hv_exp_f(bIn);
+#endif
+}
+
+static inline void __hv_log_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX || HV_SIMD_SSE || HV_SIMD_NEON
+  hv_bufferf_t x, e, k, z, y;
+  __hv_max_f(bIn, __hv_splat_f(1.17549435e-38f), &x); // clamp to the smallest normal float
+  __hv_frexp_f(x, &x, &e);
+
+  // shift the mantissa into [sqrt(0.5), sqrt(2)) and subtract one
+  __hv_lt_f(x, __hv_splat_f(0.707106781186547524f), &k);
+  __hv_and_f(__hv_splat_f(1.0f), k, &z);
+  __hv_sub_f(e, z, &e);
+  __hv_and_f(x, k, &k);
+  __hv_sub_f(x, __hv_splat_f(1.0f), &x);
+  __hv_add_f(x, k, &x);
+
+  __hv_mul_f(x, x, &z);
+  __hv_fma_f(x, __hv_splat_f(7.0376836292e-2f), __hv_splat_f(-1.1514610310e-1f), &y);
+  __hv_fma_f(y, x, __hv_splat_f(1.1676998740e-1f), &y);
+  __hv_fma_f(y, x, __hv_splat_f(-1.2420140846e-1f), &y);
+  __hv_fma_f(y, x, __hv_splat_f(1.4249322787e-1f), &y);
+  __hv_fma_f(y, x, __hv_splat_f(-1.6668057665e-1f), &y);
+  __hv_fma_f(y, x, __hv_splat_f(2.0000714765e-1f), &y);
+  __hv_fma_f(y, x, __hv_splat_f(-2.4999993993e-1f), &y);
+  __hv_fma_f(y, x, __hv_splat_f(3.3333331174e-1f), &y);
+  __hv_mul_f(y, x, &y);
+  __hv_mul_f(y, z, &y);
+
+  __hv_fma_f(e, __hv_splat_f(-2.12194440e-4f), y, &y);
+  __hv_fma_f(z, __hv_splat_f(-0.5f), y, &y);
+  __hv_add_f(x, y, &x);
+  __hv_barrier_f(&x); // the larger part of ln(2) is added last
+  __hv_fma_f(e, __hv_splat_f(0.693359375f), x, &x);
+
+  // log(x <= 0) == 0
+  __hv_gt_f(bIn, __hv_splat_f(0.0f), &k);
+  __hv_and_f(x, k, bOut);
+#else // HV_SIMD_NONE
+  *bOut = (bIn > 0.0f) ? hv_log_f(bIn) : 0.0f;
+#endif
+}
+
+static inline void __hv_log2_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX || HV_SIMD_SSE || HV_SIMD_NEON
+  __hv_log_f(bIn, bOut);
+  __hv_mul_f(*bOut, __hv_splat_f(1.44269504088896341f), bOut); // 1/ln(2)
+#else // HV_SIMD_NONE
+  *bOut = (bIn > 0.0f) ? hv_log2_f(bIn) : 0.0f;
+#endif
+}
+
+static inline void __hv_log10_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX || HV_SIMD_SSE || HV_SIMD_NEON
+  __hv_log_f(bIn, bOut);
+  __hv_mul_f(*bOut, __hv_splat_f(0.434294481903251828f), bOut); // 1/ln(10)
+#else // HV_SIMD_NONE
+  *bOut = (bIn > 0.0f) ? hv_log10_f(bIn) : 0.0f;
+#endif
+}
+
+#if HV_APPLE
+#pragma mark - Trigonometric
+#endif
+
+// The SIMD trigonometric kernels reduce the argument by multiples of pi (or pi/2)
+// and evaluate a minimax polynomial in vector registers. Define HV_FAST_TRIG
+// to 1 to trade accuracy for speed: the reduction of sin/cos then uses a single
+// constant (accurate for |x| < ~100) and a 5th instead of 9th order polynomial.
+// tan always reduces exactly, as any error in r is unbounded near its poles.
+// Max error against libm, measured as for exp and log, absolute where |f(x)| < 1
+// and relative otherwise:
+//   __hv_sin_f, __hv_cos_f: 1.7e-7 for |x| < 100 (HV_FAST_TRIG: 7.4e-5)
+//   __hv_tan_f:  2.7e-7 for |x| < 100
+//   __hv_tanh_f: 1.1e-7
+#ifndef HV_FAST_TRIG
+#define HV_FAST_TRIG 0
+#endif
+
+// bOut = bMask ? bIn0 : bIn1, bMask as returned by the comparison functions
+static inline void __hv_select_f(hv_bInf_t bMask, hv_bInf_t bIn0, hv_bInf_t bIn1, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX
+  *bOut = _mm256_blendv_ps(bIn1, bIn0, bMask);
+#elif HV_SIMD_SSE
+  *bOut = _mm_blendv_ps(bIn1, bIn0, bMask);
+#elif HV_SIMD_NEON
+  *bOut = vbslq_f32(vreinterpretq_u32_f32(bMask), bIn0, bIn1);
+#else // HV_SIMD_NONE
+  *bOut = (bMask != 0.0f) ? bIn0 : bIn1;
+#endif
+}
+
+// returns a mask of the integer-valued elements which are odd
+static inline void __hv_isodd_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX
+  const __m256 h = _mm256_mul_ps(bIn, _mm256_set1_ps(0.5f));
+  *bOut = _mm256_cmp_ps(h, _mm256_round_ps(h, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC), _CMP_NEQ_OQ);
+#elif HV_SIMD_SSE
+  const __m128i one = _mm_set1_epi32(1);
+  *bOut = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_cvtps_epi32(bIn), one), one));
+#elif HV_SIMD_NEON
+  *bOut = vreinterpretq_f32_u32(vtstq_s32(vcvtq_s32_f32(bIn), vdupq_n_s32(1)));
+#else // HV_SIMD_NONE
+  *bOut = (((int) bIn) & 0x1) ? 1.0f : 0.0f;
+#endif
+}
+
+// full precision 1/x (NEON refines its reciprocal estimate with two Newton-Raphson steps)
+static inline void __hv_rcp_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX
+  *bOut = _mm256_div_ps(_mm256_set1_ps(1.0f), bIn);
+#elif HV_SIMD_SSE
+  *bOut = _mm_div_ps(_mm_set1_ps(1.0f), bIn);
+#elif HV_SIMD_NEON
+  float32x4_t r = vrecpeq_f32(bIn);
+  r = vmulq_f32(vrecpsq_f32(bIn, r), r);
+  *bOut = vmulq_f32(vrecpsq_f32(bIn, r), r);
+#else // HV_SIMD_NONE
+  *bOut = 1.0f/bIn;
+#endif
+}
+
+// sin(x) for x in [-pi/2, pi/2]
+static inline void __hv_sin_poly_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+  hv_bufferf_t z, y;
+  __hv_mul_f(bIn, bIn, &z);
+#if HV_FAST_TRIG
+  __hv_fma_f(z, __hv_splat_f(7.5143825393e-3f), __hv_splat_f(-1.6567309728e-1f), &y);
+  __hv_fma_f(y, z, __hv_splat_f(9.9969678622e-1f), &y);
+#else
+  __hv_fma_f(z, __hv_splat_f(2.5904912992e-6f), __hv_splat_f(-1.9800899362e-4f), &y);
+  __hv_fma_f(y, z, __hv_splat_f(8.3328998542e-3f), &y);
+  __hv_fma_f(y, z, __hv_splat_f(-1.6666647637e-1f), &y);
+  __hv_fma_f(y, z, __hv_splat_f(9.9999997659e-1f), &y);
+#endif
+  __hv_mul_f(y, bIn, bOut);
+}
+
+// bOut = bIn - bN*pi, with pi split into parts so that bN*pi is exact
+static inline void __hv_reduce_pi_exact_f(hv_bInf_t bIn, hv_bInf_t bN, hv_bOutf_t bOut) {
+  __hv_fma_f(bN, __hv_splat_f(-3.140625f), bIn, bOut);
+  __hv_barrier_f(bOut);
+  __hv_fma_f(bN, __hv_splat_f(-9.67502593994140625e-4f), *bOut, bOut);
+  __hv_barrier_f(bOut);
+  __hv_fma_f(bN, __hv_splat_f(-1.509957990978376432e-7f), *bOut, bOut);
+  __hv_barrier_f(bOut);
+}
+
+static inline void __hv_reduce_pi_f(hv_bInf_t bIn, hv_bInf_t bN, hv_bOutf_t bOut) {
+#if HV_FAST_TRIG
+  __hv_fma_f(bN, __hv_splat_f(-3.14159265358979324f), bIn, bOut);
+#else
+  __hv_reduce_pi_exact_f(bIn, bN, bOut);
+#endif
+}
+
+static inline void __hv_sin_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX || HV_SIMD_SSE || HV_SIMD_NEON
+  // sin(x) = (-1)^n * sin(x - n*pi)
+  hv_bufferf_t n, x, k;
+  __hv_mul_f(bIn, __hv_splat_f(0.318309886183790672f), &n); // 1/pi
+  __hv_rint_f(n, &n);
+  __hv_reduce_pi_f(bIn, n, &x);
+  __hv_sin_poly_f(x, &x);
+  __hv_isodd_f(n, &n);
+  __hv_sub_f(__hv_splat_f(0.0f), x, &k);
+  __hv_select_f(n, k, x, bOut);
+#else // HV_SIMD_NONE
+  *bOut = hv_sin_f(bIn);
+#endif
+}
+
+static inline void __hv_cos_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX || HV_SIMD_SSE || HV_SIMD_NEON
+  // cos(x) = (-1)^(n+1) * sin(x - (n+1/2)*pi)
+  hv_bufferf_t n, x, k;
+  __hv_mul_f(bIn, __hv_splat_f(0.318309886183790672f), &n);
+  __hv_sub_f(n, __hv_splat_f(0.5f), &n);
+  __hv_rint_f(n, &n);
+  __hv_add_f(n, __hv_splat_f(0.5f), &k);
+  __hv_reduce_pi_f(bIn, k, &x);
+  __hv_sin_poly_f(x, &x);
+  __hv_isodd_f(n, &n);
+  __hv_sub_f(__hv_splat_f(0.0f), x, &k);
+  __hv_select_f(n, x, k, bOut);
+#else // HV_SIMD_NONE
+  *bOut = hv_cos_f(bIn);
+#endif
+}
+
+static inline void __hv_tan_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX || HV_SIMD_SSE || HV_SIMD_NEON
+  // tan(x) = tan(r) for even n, -1/tan(r) for odd n, where r = x - n*pi/2
+  hv_bufferf_t n, x, z, y;
+  __hv_mul_f(bIn, __hv_splat_f(0.636619772367581343f), &n); // 2/pi
+  __hv_rint_f(n, &n);
+  __hv_mul_f(n, __hv_splat_f(0.5f), &z);
+  __hv_reduce_pi_exact_f(bIn, z, &x);
+
+  __hv_mul_f(x, x, &z);
+  __hv_fma_f(z, __hv_splat_f(9.38540185543e-3f), __hv_splat_f(3.11992232697e-3f), &y);
+  __hv_fma_f(y, z, __hv_splat_f(2.44301354525e-2f), &y);
+  __hv_fma_f(y, z, __hv_splat_f(5.34112807005e-2f), &y);
+  __hv_fma_f(y, z, __hv_splat_f(1.33387994085e-1f), &y);
+  __hv_fma_f(y, z, __hv_splat_f(3.33331568548e-1f), &y);
+  __hv_mul_f(y, z, &y);
+  __hv_fma_f(y, x, x, &y);
+
+  __hv_rcp_f(y, &z);
+  __hv_sub_f(__hv_splat_f(0.0f), z, &z);
+  __hv_isodd_f(n, &n);
+  __hv_select_f(n, z, y, bOut);
+#else // HV_SIMD_NONE
+  *bOut = hv_tan_f(bIn);
+#endif
+}
+
+static inline void __hv_tanh_f(hv_bInf_t bIn, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX || HV_SIMD_SSE || HV_SIMD_NEON
+  hv_bufferf_t a, z, y, k;
+
+  // |x| >= 0.625: tanh(|x|) = 1 - 2/(exp(2|x|) + 1)
+  __hv_abs_f(bIn, &a);
+  __hv_add_f(a, a, &z);
+  __hv_exp_f(z, &z);
+  __hv_add_f(z, __hv_splat_f(1.0f), &z);
+  __hv_rcp_f(z, &z);
+  __hv_fma_f(z, __hv_splat_f(-2.0f), __hv_splat_f(1.0f), &z);
+  __hv_sub_f(__hv_splat_f(0.0f), z, &k);
+  __hv_lt_f(bIn, __hv_splat_f(0.0f), &y);
+  __hv_select_f(y, k, z, &k);
+
+  // |x| < 0.625: polynomial, which avoids cancellation around zero
+  __hv_mul_f(bIn, bIn, &z);
+  __hv_fma_f(z, __hv_splat_f(-5.70498872745e-3f), __hv_splat_f(2.06390887954e-2f), &y);
+  __hv_fma_f(y, z, __hv_splat_f(-5.37397155531e-2f), &y);
+  __hv_fma_f(y, z, __hv_splat_f(1.33314422036e-1f), &y);
+  __hv_fma_f(y, z, __hv_splat_f(-3.33332819422e-1f), &y);
+  __hv_mul_f(y, z, &y);
+  __hv_fma_f(y, bIn, bIn, &y);
+
+  __hv_lt_f(a, __hv_splat_f(0.625f), &a);
+  __hv_select_f(a, y, k, bOut);
+#else // HV_SIMD_NONE
+  *bOut = hv_tanh_f(bIn);
+#endif
+}
+
 #endif // _HEAVY_MATH_H_
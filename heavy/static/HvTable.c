@@ -25,6 +25,11 @@ hv_size_t hTable_init(HvTable *o, int length) {
   // add an extra length for mirroring
   o->allocated = o->size + HV_N_SIMD;
   o->head = 0;
+  o->generation = 0;
+  o->pending = NULL;
+  o->retired = NULL;
+  o->nextPending = NULL;
+  o->nextRetired = NULL;
   hv_size_t numBytes = o->allocated * sizeof(float);
   o->buffer = (float *) hv_malloc(numBytes);
   hv_memclear(o->buffer, numBytes);
@@ -36,6 +41,11 @@ hv_size_t hTable_initWithData(HvTable *o, int length, const float *const data) {
   o->size = (length + HV_N_SIMD_MASK) & ~HV_N_SIMD_MASK;
   o->allocated = o->size + HV_N_SIMD;
   o->head = 0;
+  o->generation = 0;
+  o->pending = NULL;
+  o->retired = NULL;
+  o->nextPending = NULL;
+  o->nextRetired = NULL;
   hv_size_t numBytes = o->size * sizeof(float);
   o->buffer = (float *) hv_malloc(numBytes);
   hv_memclear(o->buffer, numBytes);
@@ -49,11 +59,25 @@ hv_size_t hTable_initWithFinalData(HvTable *o, int length, float *data) {
   o->allocated = length;
   o->buffer = data;
   o->head = 0;
+  o->generation = 0;
+  o->pending = NULL;
+  o->retired = NULL;
+  o->nextPending = NULL;
+  o->nextRetired = NULL;
   return 0;
 }
 
+static void hTable_freeBuffer(HvTableBuffer *b) {
+  if (b != NULL) {
+    hv_free(b->buffer);
+    hv_free(b);
+  }
+}
+
 void hTable_free(HvTable *o) {
   hv_free(o->buffer);
+  hTable_freeBuffer(o->pending);
+  hTable_freeBuffer(o->retired);
 }
 
 int hTable_resize(HvTable *o, hv_uint32_t newLength) {
@@ -83,9 +107,58 @@ int hTable_resize(HvTable *o, hv_uint32_t newLength) {
   o->length = newLength;
   o->size = newSize;
   o->allocated = newAllocated;
+  ++o->generation;
   return (int) (newBytes - oldBytes);
 }
 
+hv_size_t hTable_publish(HvTable *o, const float *data, hv_uint32_t length,
+    bool *wasPending) {
+  // objects such as conv~ and tabread~ keep positions in the table, so only
+  // its contents may be replaced
+  if (length != o->length) return 0;
+
+  // the buffer is aligned, cleared and mirrored here, so that the swap is only an exchange of pointers
+  HvTableBuffer *b = (HvTableBuffer *) hv_malloc(sizeof(HvTableBuffer));
+  hv_assert(b != NULL);
+  b->length = length;
+  const hv_size_t numBytes = (((length + HV_N_SIMD_MASK) & ~HV_N_SIMD_MASK) + HV_N_SIMD) * sizeof(float);
+  b->buffer = (float *) hv_malloc(numBytes);
+  hv_assert(b->buffer != NULL);
+  hv_memclear(b->buffer, numBytes);
+  hv_memcpy(b->buffer, data, length*sizeof(float));
+  hv_memcpy(b->buffer+o->size, b->buffer, HV_N_SIMD*sizeof(float));
+
+  // a buffer which has not been picked up yet is replaced, and freed here
+  HvTableBuffer *old = (HvTableBuffer *) hv_atomic_exchange_ptr(&o->pending, b);
+  *wasPending = (old != NULL);
+  hTable_freeBuffer(old);
+  return numBytes;
+}
+
+bool hTable_update(HvTable *o) {
+  // the buffer which would be replaced has nowhere to go until the loader
+  // has freed the last one
+  if (hv_atomic_load_ptr(&o->retired) != NULL) return false;
+  HvTableBuffer *b = (HvTableBuffer *) hv_atomic_exchange_ptr(&o->pending, NULL);
+  if (b == NULL) return true;
+
+  // exchange the buffers, the old one is handed back in the same structure.
+  // If the patch has resized the table since the buffer was published, the
+  // buffer is handed back unused.
+  if (b->length == o->length) {
+    float *const buffer = o->buffer;
+    o->buffer = b->buffer;
+    b->buffer = buffer;
+    ++o->generation;
+  }
+  hv_atomic_store_ptr(&o->retired, b);
+  return true;
+}
+
+void hTable_collect(HvTable *o) {
+  hTable_freeBuffer((HvTableBuffer *) hv_atomic_exchange_ptr(&o->retired, NULL));
+}
+
 void hTable_onMessage(HvBase *_c, HvTable *o, int letIn, const HvMessage *const m,
     void (*sendMessage)(HvBase *, int, const HvMessage *const)) {
   if (msg_compareSymbol(m,0,"resize") && msg_isFloat(m,1) && msg_getFloat(m,1) >= 0.0f) {
@@ -20,6 +20,12 @@
 struct HvBase;
 struct HvMessage;
 
+// a buffer prepared for a table outside of the audio thread
+typedef struct HvTableBuffer {
+  float *buffer;
+  hv_uint32_t length;
+} HvTableBuffer;
+
 typedef struct HvTable {
   float *buffer;
   // the number of values that the table is requested to have
@@ -35,6 +41,18 @@ typedef struct HvTable {
   hv_uint32_t allocated;
 
   hv_uint32_t head; // the most recently written point
+
+  // incremented whenever the buffer is replaced or resized, so that objects
+  // which keep something derived from the contents know to update it
+  hv_uint32_t generation;
+
+  // A buffer published by a loader thread, waiting to be swapped in at the
+  // start of the next block, and the buffer which it replaced, waiting to be
+  // freed by the loader. Both are exchanged atomically.
+  HvTableBuffer *pending;
+  HvTableBuffer *retired;
+  struct HvTable *nextPending; // in the list of tables of the context with a pending buffer
+  struct HvTable *nextRetired; // in the list of tables of the context with a retired buffer
 } HvTable;
 
 hv_size_t hTable_init(HvTable *o, int length);
@@ -47,6 +65,28 @@ void hTable_free(HvTable *o);
 
 int hTable_resize(HvTable *o, hv_uint32_t newLength);
 
+/**
+ * Prepares a buffer with a copy of the data, outside of the audio thread,
+ * and publishes it to be swapped in by hTable_update(). A buffer which has
+ * not been swapped in yet is replaced. Only one thread may publish to a
+ * table. wasPending is set if a buffer was replaced, in which case the table
+ * is still waiting for hTable_update(). Returns the number of bytes
+ * allocated, or zero if the length of the data is not that of the table, as
+ * only the contents may be replaced.
+ */
+hv_size_t hTable_publish(HvTable *o, const float *data, hv_uint32_t length,
+    bool *wasPending);
+
+/**
+ * Swaps in a published buffer, on the audio thread. It never allocates or
+ * frees. Returns false if a buffer is still waiting to be swapped in, which
+ * it cannot be until hTable_collect() has freed the last one.
+ */
+bool hTable_update(HvTable *o);
+
+/** Frees the buffer replaced by the last swap, on the publishing thread. */
+void hTable_collect(HvTable *o);
+
 void hTable_onMessage(HvBase *_c, HvTable *o, int letIn, const HvMessage *const m,
     void (*sendMessage)(HvBase *, int, const HvMessage *const));
 
@@ -69,6 +109,10 @@ static inline hv_uint32_t hTable_getAllocated(HvTable *o) {
   return o->allocated;
 }
 
+static inline hv_uint32_t hTable_getGeneration(HvTable *o) {
+  return o->generation;
+}
+
 static inline hv_uint32_t hTable_getHead(HvTable *o) {
   return o->head;
 }
@@ -50,6 +50,7 @@
   #define HV_SIMD_SSE (__SSE__ && __SSE2__ && __SSE3__ && __SSSE3__ && __SSE4_1__)
   #define HV_SIMD_AVX (__AVX__ && HV_SIMD_SSE)
   #define HV_SIMD_FMA __FMA__
+  #define HV_SIMD_AVX2 (__AVX2__ && HV_SIMD_AVX)
 #endif
 
 #if HV_SIMD_AVX || HV_SIMD_SSE
@@ -166,6 +167,20 @@
 #include <assert.h>
 #define hv_assert(e) assert(e)
 
+// Atomic pointers, for handing buffers between threads without locks
+#if HV_MSVC
+  #include <intrin.h>
+  #define hv_atomic_load_ptr(p) _InterlockedCompareExchangePointer((void *volatile *) (p), NULL, NULL)
+  #define hv_atomic_store_ptr(p, x) ((void) _InterlockedExchangePointer((void *volatile *) (p), (x)))
+  #define hv_atomic_exchange_ptr(p, x) _InterlockedExchangePointer((void *volatile *) (p), (x))
+  #define hv_atomic_cas_ptr(p, e, x) (_InterlockedCompareExchangePointer((void *volatile *) (p), (x), (e)) == (e))
+#else
+  #define hv_atomic_load_ptr(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+  #define hv_atomic_store_ptr(p, x) __atomic_store_n(p, x, __ATOMIC_RELEASE)
+  #define hv_atomic_exchange_ptr(p, x) __atomic_exchange_n(p, x, __ATOMIC_ACQ_REL)
+  #define hv_atomic_cas_ptr(p, e, x) __sync_bool_compare_and_swap(p, e, x)
+#endif
+
 // Export and Inline
 #if HV_MSVC
 #define HV_EXPORT __declspec(dllexport)
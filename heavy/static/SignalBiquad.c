@@ -19,89 +19,6 @@
 // http://reanimator-web.appspot.com/articles/simdiir
 // http://musicdsp.org/files/Audio-EQ-Cookbook.txt
 
-hv_size_t sBiquad_init(SignalBiquad *o) {
-#if HV_SIMD_AVX
-  o->xm1 = _mm256_setzero_ps();
-  o->xm2 = _mm256_setzero_ps();
-#elif HV_SIMD_SSE
-  o->xm1 = _mm_setzero_ps();
-  o->xm2 = _mm_setzero_ps();
-#elif HV_SIMD_NEON
-  o->xm1 = vdupq_n_f32(0.0f);
-  o->xm2 = vdupq_n_f32(0.0f);
-#else // HV_SIMD_NONE
-  o->x1 = 0.0f;
-  o->x2 = 0.0f;
-#endif
-  o->y1 = 0.0f;
-  o->y2 = 0.0f;
-  return 0;
-}
-
-void __hv_biquad_f(SignalBiquad *o, hv_bInf_t bIn, hv_bInf_t bX0, hv_bInf_t bX1, hv_bInf_t bX2, hv_bInf_t bY1, hv_bInf_t bY2, hv_bOutf_t bOut) {
-#if HV_SIMD_AVX
-  __m256 a = _mm256_mul_ps(bIn, bX0);
-  __m256 b = _mm256_mul_ps(o->xm1, bX1);
-  __m256 c = _mm256_mul_ps(o->xm2, bX2);
-  __m256 d = _mm256_add_ps(a, b);
-  __m256 e = _mm256_add_ps(c, d); // bIn*bX0 + o->x1*bX1 + o->x2*bX2
-  float y0 = e[0] - o->y1*bY1[0] - o->y2*bY2[0];
-  float y1 = e[1] - y0*bY1[1] - o->y1*bY2[1];
-  float y2 = e[2] - y1*bY1[2] - y0*bY2[2];
-  float y3 = e[3] - y2*bY1[3] - y1*bY2[3];
-  float y4 = e[4] - y3*bY1[4] - y2*bY2[4];
-  float y5 = e[5] - y4*bY1[5] - y3*bY2[5];
-  float y6 = e[6] - y5*bY1[6] - y4*bY2[6];
-  float y7 = e[7] - y6*bY1[7] - y5*bY2[7];
-
-  o->xm2 = o->xm1;
-  o->xm1 = bIn;
-  o->y1 = y7;
-  o->y2 = y6;
-
-  *bOut = _mm256_set_ps(y7, y6, y5, y4, y3, y2, y1, y0);
-#elif HV_SIMD_SSE
-  __m128 a = _mm_mul_ps(bIn, bX0);
-  __m128 b = _mm_mul_ps(o->xm1, bX1);
-  __m128 c = _mm_mul_ps(o->xm2, bX2);
-  __m128 d = _mm_add_ps(a, b);
-  __m128 e = _mm_add_ps(c, d);
-  float y0 = e[0] - o->y1*bY1[0] - o->y2*bY2[0];
-  float y1 = e[1] - y0*bY1[1] - o->y1*bY2[1];
-  float y2 = e[2] - y1*bY1[2] - y0*bY2[2];
-  float y3 = e[3] - y2*bY1[3] - y1*bY2[3];
-
-  o->xm2 = o->xm1;
-  o->xm1 = bIn;
-  o->y1 = y3;
-  o->y2 = y2;
-
-  *bOut = _mm_set_ps(y3, y2, y1, y0);
-#elif HV_SIMD_NEON
-  float32x4_t a = vmulq_f32(bIn, bX0);
-  float32x4_t b = vmulq_f32(o->xm1, bX1);
-  float32x4_t c = vmulq_f32(o->xm2, bX2);
-  float32x4_t d = vaddq_f32(a, b);
-  float32x4_t e = vaddq_f32(c, d);
-  float y0 = e[0] - o->y1*bY1[0] - o->y2*bY2[0];
-  float y1 = e[1] - y0*bY1[1] - o->y1*bY2[1];
-  float y2 = e[2] - y1*bY1[2] - y0*bY2[2];
-  float y3 = e[3] - y2*bY1[3] - y1*bY2[3];
-
-  o->xm2 = o->xm1;
-  o->xm1 = bIn;
-  o->y1 = y3;
-  o->y2 = y2;
-
-  *bOut = (float32x4_t) {y0, y1, y2, y3};
-#else
-  const float y = bIn*bX0 + o->x1*bX1 + o->x2*bX2 - o->y1*bY1 - o->y2*bY2;
-  o->x2 = o->x1; o->x1 = bIn;
-  o->y2 = o->y1; o->y1 = y;
-  *bOut = y;
-#endif
-}
-
 static void sBiquad_k_updateCoefficients(SignalBiquad_k *const o) {
   // calculate all filter coefficients in the double domain
 #if HV_SIMD_AVX || HV_SIMD_SSE || HV_SIMD_NEON
@@ -190,3 +107,206 @@ void sBiquad_k_onMessage(SignalBiquad_k *o, int letIn, const HvMessage *const m)
     sBiquad_k_updateCoefficients(o);
   }
 }
+
+hv_size_t sBiquad_init(SignalBiquad *o) {
+#if HV_SIMD_AVX
+  o->xm = _mm256_setzero_ps();
+#elif HV_SIMD_SSE
+  o->xm = _mm_setzero_ps();
+#elif HV_SIMD_NEON
+  o->xm = vdupq_n_f32(0.0f);
+#else // HV_SIMD_NONE
+  o->x1 = 0.0f;
+  o->x2 = 0.0f;
+#endif
+  o->y1 = 0.0f;
+  o->y2 = 0.0f;
+#if HV_SIMD_AVX || HV_SIMD_SSE || HV_SIMD_NEON
+  sBiquad_k_init(&o->k, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+#endif
+  return 0;
+}
+
+#if HV_SIMD_AVX || HV_SIMD_SSE || HV_SIMD_NEON
+// returns true if every coefficient buffer holds the same value in all lanes
+static inline bool sBiquad_isConstant(hv_bInf_t bX0, hv_bInf_t bX1, hv_bInf_t bX2, hv_bInf_t bY1, hv_bInf_t bY2) {
+#if HV_SIMD_AVX
+  __m256 a = _mm256_cmp_ps(bX0, _mm256_set1_ps(bX0[0]), _CMP_EQ_OQ);
+  __m256 b = _mm256_cmp_ps(bX1, _mm256_set1_ps(bX1[0]), _CMP_EQ_OQ);
+  __m256 c = _mm256_cmp_ps(bX2, _mm256_set1_ps(bX2[0]), _CMP_EQ_OQ);
+  __m256 d = _mm256_cmp_ps(bY1, _mm256_set1_ps(bY1[0]), _CMP_EQ_OQ);
+  __m256 e = _mm256_cmp_ps(bY2, _mm256_set1_ps(bY2[0]), _CMP_EQ_OQ);
+  a = _mm256_and_ps(_mm256_and_ps(a, b), _mm256_and_ps(c, _mm256_and_ps(d, e)));
+  return _mm256_movemask_ps(a) == 0xFF;
+#elif HV_SIMD_SSE
+  __m128 a = _mm_cmpeq_ps(bX0, _mm_set1_ps(bX0[0]));
+  __m128 b = _mm_cmpeq_ps(bX1, _mm_set1_ps(bX1[0]));
+  __m128 c = _mm_cmpeq_ps(bX2, _mm_set1_ps(bX2[0]));
+  __m128 d = _mm_cmpeq_ps(bY1, _mm_set1_ps(bY1[0]));
+  __m128 e = _mm_cmpeq_ps(bY2, _mm_set1_ps(bY2[0]));
+  a = _mm_and_ps(_mm_and_ps(a, b), _mm_and_ps(c, _mm_and_ps(d, e)));
+  return _mm_movemask_ps(a) == 0xF;
+#else // HV_SIMD_NEON
+  uint32x4_t a = vceqq_f32(bX0, vdupq_n_f32(bX0[0]));
+  uint32x4_t b = vceqq_f32(bX1, vdupq_n_f32(bX1[0]));
+  uint32x4_t c = vceqq_f32(bX2, vdupq_n_f32(bX2[0]));
+  uint32x4_t d = vceqq_f32(bY1, vdupq_n_f32(bY1[0]));
+  uint32x4_t e = vceqq_f32(bY2, vdupq_n_f32(bY2[0]));
+  a = vandq_u32(vandq_u32(a, b), vandq_u32(c, vandq_u32(d, e)));
+  uint32x2_t f = vand_u32(vget_low_u32(a), vget_high_u32(a));
+  return (vget_lane_u32(f, 0) & vget_lane_u32(f, 1)) == 0xFFFFFFFF;
+#endif
+}
+
+// filters one buffer with the block formulation, recalculating the block
+// coefficients only if they have changed since the last constant buffer
+static inline void sBiquad_processBlock(SignalBiquad *o, hv_bInf_t bIn,
+    float b0, float b1, float b2, float a1, float a2, hv_bOutf_t bOut) {
+  SignalBiquad_k *const k = &o->k;
+  if (b0 != k->b0 || b1 != k->b1 || b2 != k->b2 || a1 != k->a1 || a2 != k->a2) {
+    k->b0 = b0; k->b1 = b1; k->b2 = b2; k->a1 = a1; k->a2 = a2;
+    sBiquad_k_updateCoefficients(k);
+  }
+#if HV_SIMD_AVX
+  k->xm1 = _mm_set1_ps(o->xm[7]);
+  k->xm2 = _mm_set1_ps(o->xm[6]);
+  k->ym1 = _mm_set1_ps(o->y1);
+  k->ym2 = _mm_set1_ps(o->y2);
+#elif HV_SIMD_SSE
+  k->xm1 = _mm_shuffle_ps(o->xm, o->xm, _MM_SHUFFLE(3,3,3,3));
+  k->xm2 = _mm_shuffle_ps(o->xm, o->xm, _MM_SHUFFLE(2,2,2,2));
+  k->ym1 = _mm_set1_ps(o->y1);
+  k->ym2 = _mm_set1_ps(o->y2);
+#else // HV_SIMD_NEON
+  k->xm1 = vdupq_n_f32(o->xm[3]);
+  k->xm2 = vdupq_n_f32(o->xm[2]);
+  k->ym1 = vdupq_n_f32(o->y1);
+  k->ym2 = vdupq_n_f32(o->y2);
+#endif
+  __hv_biquad_k_f(k, bIn, bOut);
+  o->xm = bIn;
+  o->y1 = (*bOut)[HV_N_SIMD-1];
+  o->y2 = (*bOut)[HV_N_SIMD-2];
+}
+#endif
+
+void __hv_biquad_f(SignalBiquad *o, hv_bInf_t bIn, hv_bInf_t bX0, hv_bInf_t bX1, hv_bInf_t bX2, hv_bInf_t bY1, hv_bInf_t bY2, hv_bOutf_t bOut) {
+#if HV_SIMD_AVX
+  if (sBiquad_isConstant(bX0, bX1, bX2, bY1, bY2)) {
+    sBiquad_processBlock(o, bIn, bX0[0], bX1[0], bX2[0], bY1[0], bY2[0], bOut);
+  } else {
+    // x[n-1] and x[n-2], shifted in from the previous input buffer
+    __m256 p = _mm256_permute2f128_ps(o->xm, bIn, 0x21); // {xm[4..7], bIn[0..3]}
+    __m256 t = _mm256_shuffle_ps(p, bIn, _MM_SHUFFLE(0,0,3,3));
+    __m256 xm1 = _mm256_shuffle_ps(t, bIn, _MM_SHUFFLE(2,1,2,0));
+    __m256 xm2 = _mm256_shuffle_ps(p, bIn, _MM_SHUFFLE(1,0,3,2));
+
+    __m256 a = _mm256_mul_ps(bIn, bX0);
+    __m256 b = _mm256_mul_ps(xm1, bX1);
+    __m256 c = _mm256_mul_ps(xm2, bX2);
+    __m256 d = _mm256_add_ps(a, b);
+    __m256 e = _mm256_add_ps(c, d); // bIn*bX0 + x[n-1]*bX1 + x[n-2]*bX2
+    float y0 = e[0] - o->y1*bY1[0] - o->y2*bY2[0];
+    float y1 = e[1] - y0*bY1[1] - o->y1*bY2[1];
+    float y2 = e[2] - y1*bY1[2] - y0*bY2[2];
+    float y3 = e[3] - y2*bY1[3] - y1*bY2[3];
+    float y4 = e[4] - y3*bY1[4] - y2*bY2[4];
+    float y5 = e[5] - y4*bY1[5] - y3*bY2[5];
+    float y6 = e[6] - y5*bY1[6] - y4*bY2[6];
+    float y7 = e[7] - y6*bY1[7] - y5*bY2[7];
+
+    o->xm = bIn;
+    o->y1 = y7;
+    o->y2 = y6;
+
+    *bOut = _mm256_set_ps(y7, y6, y5, y4, y3, y2, y1, y0);
+  }
+#elif HV_SIMD_SSE
+  if (sBiquad_isConstant(bX0, bX1, bX2, bY1, bY2)) {
+    sBiquad_processBlock(o, bIn, bX0[0], bX1[0], bX2[0], bY1[0], bY2[0], bOut);
+  } else {
+    // x[n-1] and x[n-2], shifted in from the previous input buffer
+    __m128 t = _mm_shuffle_ps(o->xm, bIn, _MM_SHUFFLE(0,0,3,3));
+    __m128 xm1 = _mm_shuffle_ps(t, bIn, _MM_SHUFFLE(2,1,2,0));
+    __m128 xm2 = _mm_shuffle_ps(o->xm, bIn, _MM_SHUFFLE(1,0,3,2));
+
+    __m128 a = _mm_mul_ps(bIn, bX0);
+    __m128 b = _mm_mul_ps(xm1, bX1);
+    __m128 c = _mm_mul_ps(xm2, bX2);
+    __m128 d = _mm_add_ps(a, b);
+    __m128 e = _mm_add_ps(c, d);
+    float y0 = e[0] - o->y1*bY1[0] - o->y2*bY2[0];
+    float y1 = e[1] - y0*bY1[1] - o->y1*bY2[1];
+    float y2 = e[2] - y1*bY1[2] - y0*bY2[2];
+    float y3 = e[3] - y2*bY1[3] - y1*bY2[3];
+
+    o->xm = bIn;
+    o->y1 = y3;
+    o->y2 = y2;
+
+    *bOut = _mm_set_ps(y3, y2, y1, y0);
+  }
+#elif HV_SIMD_NEON
+  if (sBiquad_isConstant(bX0, bX1, bX2, bY1, bY2)) {
+    sBiquad_processBlock(o, bIn, bX0[0], bX1[0], bX2[0], bY1[0], bY2[0], bOut);
+  } else {
+    // x[n-1] and x[n-2], shifted in from the previous input buffer
+    float32x4_t xm1 = vextq_f32(o->xm, bIn, 3);
+    float32x4_t xm2 = vextq_f32(o->xm, bIn, 2);
+
+    float32x4_t a = vmulq_f32(bIn, bX0);
+    float32x4_t b = vmulq_f32(xm1, bX1);
+    float32x4_t c = vmulq_f32(xm2, bX2);
+    float32x4_t d = vaddq_f32(a, b);
+    float32x4_t e = vaddq_f32(c, d);
+    float y0 = e[0] - o->y1*bY1[0] - o->y2*bY2[0];
+    float y1 = e[1] - y0*bY1[1] - o->y1*bY2[1];
+    float y2 = e[2] - y1*bY1[2] - y0*bY2[2];
+    float y3 = e[3] - y2*bY1[3] - y1*bY2[3];
+
+    o->xm = bIn;
+    o->y1 = y3;
+    o->y2 = y2;
+
+    *bOut = (float32x4_t) {y0, y1, y2, y3};
+  }
+#else
+  const float y = bIn*bX0 + o->x1*bX1 + o->x2*bX2 - o->y1*bY1 - o->y2*bY2;
+  o->x2 = o->x1; o->x1 = bIn;
+  o->y2 = o->y1; o->y1 = y;
+  *bOut = y;
+#endif
+}
+
+hv_size_t sBiquadBank_init(SignalBiquadBank *o) {
+  __hv_zero_f(&o->b0);
+  __hv_zero_f(&o->b1);
+  __hv_zero_f(&o->b2);
+  __hv_zero_f(&o->a1);
+  __hv_zero_f(&o->a2);
+  __hv_zero_f(&o->s1);
+  __hv_zero_f(&o->s2);
+  return 0;
+}
+
+void sBiquadBank_setCoefficients(SignalBiquadBank *o, int lane,
+    float b0, float b1, float b2, float a1, float a2) {
+  hv_assert(lane >= 0 && lane < HV_N_SIMD);
+  ((float *) &o->b0)[lane] = b0;
+  ((float *) &o->b1)[lane] = b1;
+  ((float *) &o->b2)[lane] = b2;
+  ((float *) &o->a1)[lane] = -a1;
+  ((float *) &o->a2)[lane] = -a2;
+}
+
+void sBiquadBank_processInterleaved(SignalBiquadBank *o,
+    const float *bIn, float *bOut, int numChannels, int numFrames) {
+  hv_assert(numChannels > 0 && numChannels <= HV_N_SIMD);
+  hv_bufferf_t x, y;
+  __hv_zero_f(&x);
+  for (int i = 0; i < numFrames; ++i, bIn += numChannels, bOut += numChannels) {
+    hv_memcpy(&x, bIn, numChannels*sizeof(float));
+    __hv_biquad_bank_f(o, x, &y);
+    hv_memcpy(bOut, &y, numChannels*sizeof(float));
+  }
+}
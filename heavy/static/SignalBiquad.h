@@ -18,32 +18,9 @@
 #define _HEAVY_SIGNAL_BIQUAD_H_
 
 #include "HvBase.h"
+#include "HvMath.h"
 
 // http://en.wikipedia.org/wiki/Digital_biquad_filter
-typedef struct SignalBiquad {
-#if HV_SIMD_AVX
-  __m256 xm1;
-  __m256 xm2;
-#elif HV_SIMD_SSE
-  __m128 xm1;
-  __m128 xm2;
-#elif HV_SIMD_NEON
-  float32x4_t xm1;
-  float32x4_t xm2;
-#else // HV_SIMD_NONE
-  float x1;
-  float x2;
-#endif
-  float y1;
-  float y2;
-} SignalBiquad;
-
-hv_size_t sBiquad_init(SignalBiquad *o);
-
-void __hv_biquad_f(SignalBiquad *o,
-    hv_bInf_t bIn, hv_bInf_t bX0, hv_bInf_t bX1, hv_bInf_t bX2, hv_bInf_t bY1, hv_bInf_t bY2,
-    hv_bOutf_t bOut);
-
 typedef struct SignalBiquad_k {
 #if HV_SIMD_AVX || HV_SIMD_SSE
   // preprocessed filter coefficients
@@ -232,4 +209,65 @@ static inline void __hv_biquad_k_f(SignalBiquad_k *o, hv_bInf_t bIn, hv_bOutf_t
 #endif
 }
 
+// A biquad with signal-rate coefficients. If the coefficients are constant
+// over a whole buffer, the buffer is filtered with the block formulation of
+// SignalBiquad_k instead of the serial recursion.
+typedef struct SignalBiquad {
+#if HV_SIMD_AVX
+  __m256 xm; // the previous input buffer
+#elif HV_SIMD_SSE
+  __m128 xm;
+#elif HV_SIMD_NEON
+  float32x4_t xm;
+#else // HV_SIMD_NONE
+  float x1;
+  float x2;
+#endif
+  float y1;
+  float y2;
+#if HV_SIMD_AVX || HV_SIMD_SSE || HV_SIMD_NEON
+  SignalBiquad_k k; // block coefficients for the last constant coefficients
+#endif
+} SignalBiquad;
+
+hv_size_t sBiquad_init(SignalBiquad *o);
+
+void __hv_biquad_f(SignalBiquad *o,
+    hv_bInf_t bIn, hv_bInf_t bX0, hv_bInf_t bX1, hv_bInf_t bX2, hv_bInf_t bY1, hv_bInf_t bY2,
+    hv_bOutf_t bOut);
+
+// A bank of independent biquads, one per SIMD lane. Each lane of a buffer is
+// one sample of a separate channel (e.g. lanes 0 and 1 of a stereo pair), so
+// the recursion runs across channels rather than across time.
+// Implemented in transposed direct form II.
+typedef struct SignalBiquadBank {
+  hv_bufferf_t b0;
+  hv_bufferf_t b1;
+  hv_bufferf_t b2;
+  hv_bufferf_t a1; // stored negated
+  hv_bufferf_t a2; // stored negated
+  hv_bufferf_t s1;
+  hv_bufferf_t s2;
+} SignalBiquadBank;
+
+hv_size_t sBiquadBank_init(SignalBiquadBank *o);
+
+void sBiquadBank_setCoefficients(SignalBiquadBank *o, int lane,
+    float b0, float b1, float b2, float a1, float a2);
+
+// filters numFrames frames of numChannels interleaved channels, numChannels <= HV_N_SIMD
+void sBiquadBank_processInterleaved(SignalBiquadBank *o,
+    const float *bIn, float *bOut, int numChannels, int numFrames);
+
+// filters one frame, one channel per lane
+static inline void __hv_biquad_bank_f(SignalBiquadBank *o, hv_bInf_t bIn, hv_bOutf_t bOut) {
+  hv_bufferf_t y, t;
+  __hv_fma_f(bIn, o->b0, o->s1, &y);
+  __hv_fma_f(bIn, o->b1, o->s2, &t);
+  __hv_fma_f(y, o->a1, t, &o->s1);
+  __hv_mul_f(bIn, o->b2, &t);
+  __hv_fma_f(y, o->a2, t, &o->s2);
+  *bOut = y;
+}
+
 #endif // _HEAVY_SIGNAL_BIQUAD_H_
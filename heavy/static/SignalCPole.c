@@ -73,3 +73,9 @@ hv_size_t sCPole_init(SignalCPole *o) {
 void sCPole_onMessage(HvBase *_c, SignalCPole *o, int letIn, const HvMessage *m) {
   // TODO
 }
+
+hv_size_t sCPoleBank_init(SignalCPoleBank *o) {
+  __hv_zero_f(&o->ymr);
+  __hv_zero_f(&o->ymi);
+  return 0;
+}
@@ -281,4 +281,59 @@ static inline void __hv_cpole_f(SignalCPole *o,
 #endif
 }
 
+// A bank of independent cpole~ filters, one channel per SIMD lane. The
+// recursion runs across channels rather than across time, so no chain of
+// SignalDel1 is needed.
+typedef struct SignalCPoleBank {
+  hv_bufferf_t ymr;
+  hv_bufferf_t ymi;
+} SignalCPoleBank;
+
+hv_size_t sCPoleBank_init(SignalCPoleBank *o);
+
+// filters one frame, one channel per lane
+static inline void __hv_cpole_bank_f(SignalCPoleBank *o,
+    hv_bInf_t bIn0, hv_bInf_t bIn1, hv_bInf_t bIn2, hv_bInf_t bIn3,
+    hv_bOutf_t bOut0, hv_bOutf_t bOut1) {
+  hv_bufferf_t r, i;
+  __hv_mul_f(bIn3, o->ymi, &i);
+  __hv_mul_f(bIn2, o->ymr, &r);
+  __hv_sub_f(r, i, &r); // real(a*y[n-1])
+  __hv_mul_f(bIn2, o->ymi, &i);
+  __hv_fma_f(bIn3, o->ymr, i, &i); // imag(a*y[n-1])
+  __hv_sub_f(bIn0, r, &r);
+  __hv_sub_f(bIn1, i, &i);
+  o->ymr = r;
+  o->ymi = i;
+  *bOut0 = r;
+  *bOut1 = i;
+}
+
+// filters one buffer of each of HV_N_SIMD channels. All arguments are arrays
+// of HV_N_SIMD buffers, one per channel.
+static inline void __hv_cpole_bank_block_f(SignalCPoleBank *o,
+    const hv_bufferf_t *bIn0, const hv_bufferf_t *bIn1, const hv_bufferf_t *bIn2, const hv_bufferf_t *bIn3,
+    hv_bufferf_t *bOut0, hv_bufferf_t *bOut1) {
+  hv_bufferf_t xr[HV_N_SIMD], xi[HV_N_SIMD], ar[HV_N_SIMD], ai[HV_N_SIMD];
+  for (int i = 0; i < HV_N_SIMD; ++i) {
+    xr[i] = bIn0[i];
+    xi[i] = bIn1[i];
+    ar[i] = bIn2[i];
+    ai[i] = bIn3[i];
+  }
+  __hv_transpose_f(xr);
+  __hv_transpose_f(xi);
+  __hv_transpose_f(ar);
+  __hv_transpose_f(ai);
+  for (int i = 0; i < HV_N_SIMD; ++i) {
+    __hv_cpole_bank_f(o, xr[i], xi[i], ar[i], ai[i], xr+i, xi+i);
+  }
+  __hv_transpose_f(xr);
+  __hv_transpose_f(xi);
+  for (int i = 0; i < HV_N_SIMD; ++i) {
+    bOut0[i] = xr[i];
+    bOut1[i] = xi[i];
+  }
+}
+
 #endif // _SIGNAL_CPOLE_H_
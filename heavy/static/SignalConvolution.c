@@ -16,15 +16,147 @@
 
 #include "SignalConvolution.h"
 
+#ifndef M_PI
+#define M_PI 3.14159265358979323846 // in case math.h doesn't include this defintion
+#endif
+
+#define HV_CONV_FFT_SIZE (2*HV_CONV_PARTITION_SIZE)
+
+// the stride of one stored spectrum (bins 0 to HV_CONV_PARTITION_SIZE), padded for alignment
+#define HV_CONV_SPECTRUM_STRIDE (HV_CONV_PARTITION_SIZE+HV_N_SIMD)
+
+// in-place radix-2 complex fft on split real and imaginary arrays of HV_CONV_FFT_SIZE
+static void sConv_fft(const SignalConvolution *o, float *re, float *im, bool inverse) {
+  const hv_uint32_t n = HV_CONV_FFT_SIZE;
+
+  // bit-reversal permutation
+  for (hv_uint32_t i = 1, j = 0; i < n; ++i) {
+    hv_uint32_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      float t = re[i]; re[i] = re[j]; re[j] = t;
+      t = im[i]; im[i] = im[j]; im[j] = t;
+    }
+  }
+
+  const float *const c = o->twiddles;
+  const float *const s = o->twiddles + n/2;
+  const float sign = inverse ? -1.0f : 1.0f;
+  for (hv_uint32_t len = 2; len <= n; len <<= 1) {
+    const hv_uint32_t half = len >> 1;
+    const hv_uint32_t step = n / len;
+    for (hv_uint32_t i = 0; i < n; i += len) {
+      for (hv_uint32_t k = 0; k < half; ++k) {
+        const float wr = c[k*step];
+        const float wi = sign * s[k*step];
+        const hv_uint32_t a = i + k;
+        const hv_uint32_t b = a + half;
+        const float tr = re[b]*wr - im[b]*wi;
+        const float ti = re[b]*wi + im[b]*wr;
+        re[b] = re[a] - tr; im[b] = im[a] - ti;
+        re[a] += tr; im[a] += ti;
+      }
+    }
+  }
+}
+
+// calculates the spectra of the coefficient partitions following the directly convolved taps.
+// NOTE(mhroth): the spectra are only updated when the table or the size is set, or when the
+// contents of the table are replaced or resized. Direct taps always read the table.
+static void sConv_updateSpectra(SignalConvolution *o) {
+  const hv_uint32_t P = HV_CONV_PARTITION_SIZE;
+  const float *const h = hTable_getBuffer(o->table);
+  for (hv_uint32_t k = 0; k < o->numPartitions; ++k) {
+    const hv_uint32_t offset = P + k*P;
+    const hv_uint32_t n = hv_min_ui(P, o->size - offset);
+    hv_memclear(o->fftRe, HV_CONV_FFT_SIZE*sizeof(float));
+    hv_memclear(o->fftIm, HV_CONV_FFT_SIZE*sizeof(float));
+    hv_memcpy(o->fftRe, h + offset, n*sizeof(float));
+    sConv_fft(o, o->fftRe, o->fftIm, false);
+    float *const H = o->spectra + 2*k*HV_CONV_SPECTRUM_STRIDE;
+    hv_memcpy(H, o->fftRe, (P+1)*sizeof(float));
+    hv_memcpy(H+HV_CONV_SPECTRUM_STRIDE, o->fftIm, (P+1)*sizeof(float));
+  }
+}
+
+static void sConv_freeBuffers(SignalConvolution *o) {
+  hv_free(o->history); o->history = NULL;
+  hv_free(o->spectra); o->spectra = NULL;
+  hv_free(o->fdl); o->fdl = NULL;
+  hv_free(o->tailOut); o->tailOut = NULL;
+  hv_free(o->fftRe); o->fftRe = NULL;
+  hv_free(o->fftIm); o->fftIm = NULL;
+  hv_free(o->twiddles); o->twiddles = NULL;
+}
+
+// (re)allocates all buffers for the current size and clears the filter state
+static hv_size_t sConv_configure(SignalConvolution *o) {
+  const hv_uint32_t P = HV_CONV_PARTITION_SIZE;
+  sConv_freeBuffers(o);
+  if (o->table != NULL) {
+    o->size = hv_min_ui(o->size, hTable_getSize(o->table));
+    o->tableGeneration = hTable_getGeneration(o->table);
+  }
+
+  hv_uint32_t numHeadTaps = o->size;
+  o->numPartitions = 0;
+  if (o->size > HV_CONV_DIRECT_MAX) {
+    numHeadTaps = P;
+    o->numPartitions = (o->size - P + P - 1) / P;
+  }
+
+  // the history must hold the direct taps plus one vector, and a whole fft frame
+  hv_uint32_t m = numHeadTaps + HV_N_SIMD;
+  if (o->numPartitions > 0) m = hv_max_ui(m, HV_CONV_FFT_SIZE);
+  o->historyLength = (m + HV_N_SIMD_MASK) & ~HV_N_SIMD_MASK;
+  o->historyIndex = 0;
+  o->blockIndex = 0;
+  o->fdlIndex = 0;
+
+  hv_size_t numBytes = 2*o->historyLength*sizeof(float);
+  o->history = (float *) hv_malloc(numBytes);
+  hv_memclear(o->history, numBytes);
+
+  if (o->numPartitions > 0) {
+    const hv_size_t spectraBytes = 2*o->numPartitions*HV_CONV_SPECTRUM_STRIDE*sizeof(float);
+    o->spectra = (float *) hv_malloc(spectraBytes);
+    o->fdl = (float *) hv_malloc(spectraBytes);
+    hv_memclear(o->fdl, spectraBytes);
+    o->tailOut = (float *) hv_malloc(P*sizeof(float));
+    hv_memclear(o->tailOut, P*sizeof(float));
+    o->fftRe = (float *) hv_malloc(HV_CONV_FFT_SIZE*sizeof(float));
+    o->fftIm = (float *) hv_malloc(HV_CONV_FFT_SIZE*sizeof(float));
+    o->twiddles = (float *) hv_malloc(HV_CONV_FFT_SIZE*sizeof(float));
+    for (hv_uint32_t k = 0; k < HV_CONV_FFT_SIZE/2; ++k) {
+      o->twiddles[k] = (float) cos(2.0*M_PI*k/HV_CONV_FFT_SIZE);
+      o->twiddles[k+HV_CONV_FFT_SIZE/2] = (float) -sin(2.0*M_PI*k/HV_CONV_FFT_SIZE);
+    }
+    numBytes += 2*spectraBytes + (P + 3*HV_CONV_FFT_SIZE)*sizeof(float);
+
+    if (o->table != NULL) sConv_updateSpectra(o);
+  }
+
+  return numBytes;
+}
+
 hv_size_t sConv_init(SignalConvolution *o, struct HvTable *table, const int size) {
   o->table = table;
-  hv_size_t numBytes = hTable_init(&o->inputs, size);
-  return numBytes;
+  o->tableGeneration = 0;
+  o->size = (size > 0) ? (hv_uint32_t) size : 0;
+  o->history = NULL;
+  o->spectra = NULL;
+  o->fdl = NULL;
+  o->tailOut = NULL;
+  o->fftRe = NULL;
+  o->fftIm = NULL;
+  o->twiddles = NULL;
+  return sConv_configure(o);
 }
 
 void sConv_free(SignalConvolution *o) {
   o->table = NULL;
-  hv_free(&o->inputs);
+  sConv_freeBuffers(o);
 }
 
 void sConv_onMessage(HvBase *_c, SignalConvolution *o, int letIndex,
@@ -35,21 +167,112 @@ void sConv_onMessage(HvBase *_c, SignalConvolution *o, int letIndex,
         HvTable *table = ctx_getTableForHash(_c, msg_getHash(m,0));
         if (table != NULL) {
           o->table = table;
-          if (hTable_getSize(&o->inputs) != hTable_getSize(table)) {
-            hTable_resize(&o->inputs,
-                (hv_uint32_t) hv_min_ui(hTable_getSize(&o->inputs), hTable_getSize(table)));
-          }
+          sConv_configure(o);
         }
       }
       break;
     }
     case 2: {
-      if (msg_isFloat(m,0)) {
+      if (msg_isFloat(m,0) && msg_getFloat(m,0) >= 0.0f) {
         // convolution size should never exceed the coefficient table size
-        hTable_resize(&o->inputs, (hv_uint32_t) msg_getFloat(m,0));
+        o->size = (hv_uint32_t) msg_getFloat(m,0);
+        sConv_configure(o);
       }
       break;
     }
     default: return;
   }
 }
+
+// convolves the most recent fft frame with all coefficient partitions.
+// The result is the tail contribution to the next partition block.
+static void sConv_processPartition(SignalConvolution *o, const float *const end) {
+  const hv_uint32_t P = HV_CONV_PARTITION_SIZE;
+  const hv_uint32_t S = HV_CONV_SPECTRUM_STRIDE;
+  const hv_uint32_t K = o->numPartitions;
+  float *const re = o->fftRe;
+  float *const im = o->fftIm;
+
+  // overlap-save: transform the last two partitions of input
+  hv_memcpy(re, end - HV_CONV_FFT_SIZE, HV_CONV_FFT_SIZE*sizeof(float));
+  hv_memclear(im, HV_CONV_FFT_SIZE*sizeof(float));
+  sConv_fft(o, re, im, false);
+  float *const X = o->fdl + 2*o->fdlIndex*S;
+  hv_memcpy(X, re, (P+1)*sizeof(float));
+  hv_memcpy(X+S, im, (P+1)*sizeof(float));
+
+  // multiply-accumulate the delayed input spectra with the coefficient spectra.
+  // Only bins 0 to P are needed as both are spectra of real signals.
+  hv_memclear(re, (P+1)*sizeof(float));
+  hv_memclear(im, (P+1)*sizeof(float));
+  for (hv_uint32_t k = 0; k < K; ++k) {
+    const float *const Xr = o->fdl + 2*((o->fdlIndex + K - k) % K)*S;
+    const float *const Xi = Xr + S;
+    const float *const Hr = o->spectra + 2*k*S;
+    const float *const Hi = Hr + S;
+    for (hv_uint32_t b = 0; b <= P; ++b) {
+      re[b] += Xr[b]*Hr[b] - Xi[b]*Hi[b];
+      im[b] += Xr[b]*Hi[b] + Xi[b]*Hr[b];
+    }
+  }
+  for (hv_uint32_t b = 1; b < P; ++b) {
+    re[HV_CONV_FFT_SIZE-b] = re[b];
+    im[HV_CONV_FFT_SIZE-b] = -im[b];
+  }
+  sConv_fft(o, re, im, true);
+
+  // the second half of the frame is free of circular aliasing
+  const float g = 1.0f / HV_CONV_FFT_SIZE;
+  for (hv_uint32_t i = 0; i < P; ++i) o->tailOut[i] = g * re[P+i];
+
+  o->fdlIndex = (o->fdlIndex + 1) % K;
+}
+
+// the table has been loaded or resized since the spectra were calculated. A
+// table which has become shorter than the filter is reconfigured, otherwise
+// only the spectra are recalculated.
+static void sConv_onTableChanged(SignalConvolution *o) {
+  if (o->size > hTable_getSize(o->table)) {
+    sConv_configure(o);
+  } else {
+    o->tableGeneration = hTable_getGeneration(o->table);
+    if (o->numPartitions > 0) sConv_updateSpectra(o);
+  }
+}
+
+void __hv_conv_f(SignalConvolution *o, hv_bInf_t bIn, hv_bOutf_t bOut) {
+  hv_assert(o->table != NULL);
+  if (hTable_getGeneration(o->table) != o->tableGeneration) sConv_onTableChanged(o);
+  hv_assert(o->size <= hTable_getSize(o->table));
+
+  // write the input twice, such that the history is contiguous behind the input
+  float *const x = o->history + o->historyIndex;
+  __hv_store_f(x, bIn);
+  __hv_store_f(x + o->historyLength, bIn);
+  const float *const xn = x + o->historyLength;
+
+  // directly convolve the head of the filter
+  const float *const h = hTable_getBuffer(o->table);
+  const hv_uint32_t numHeadTaps = (o->numPartitions > 0) ? HV_CONV_PARTITION_SIZE : o->size;
+  hv_bufferf_t y, a;
+  __hv_zero_f(&y);
+  for (hv_uint32_t i = 0; i < numHeadTaps; ++i) {
+    __hv_loadu_f(xn - i, &a);
+    __hv_fma_f(a, __hv_splat_f(h[i]), y, &y);
+  }
+
+  if (o->numPartitions > 0) {
+    __hv_load_f(o->tailOut + o->blockIndex, &a);
+    __hv_add_f(y, a, &y);
+    o->blockIndex += HV_N_SIMD;
+    if (o->blockIndex == HV_CONV_PARTITION_SIZE) {
+      sConv_processPartition(o, xn + HV_N_SIMD);
+      o->blockIndex = 0;
+    }
+  }
+
+  o->historyIndex += HV_N_SIMD;
+  if (o->historyIndex == o->historyLength) o->historyIndex = 0;
+
+  *bOut = y;
+}
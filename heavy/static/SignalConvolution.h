@@ -21,9 +21,39 @@
 #include "HvTable.h"
 #include "HvMath.h"
 
+// The first HV_CONV_PARTITION_SIZE taps are always convolved directly in the
+// time domain. Kernels longer than HV_CONV_DIRECT_MAX taps convolve the
+// remaining taps with a uniformly partitioned FFT (overlap-save) of
+// HV_CONV_PARTITION_SIZE samples per partition. Latency is zero in both cases.
+// HV_CONV_PARTITION_SIZE must be a power of two and a multiple of HV_N_SIMD.
+#ifndef HV_CONV_PARTITION_SIZE
+#define HV_CONV_PARTITION_SIZE 128
+#endif
+#ifndef HV_CONV_DIRECT_MAX
+#define HV_CONV_DIRECT_MAX (2*HV_CONV_PARTITION_SIZE)
+#endif
+
 typedef struct SignalConvolution {
-  struct HvTable *table;
-  struct HvTable inputs;
+  struct HvTable *table; // the coefficient table
+  hv_uint32_t tableGeneration; // the generation of the table when it was last read
+  hv_uint32_t size; // the number of taps
+
+  // input history. Every input is written twice, historyLength samples apart,
+  // such that the most recent historyLength samples are always contiguous
+  float *history;
+  hv_uint32_t historyLength;
+  hv_uint32_t historyIndex;
+
+  // the partitioned tail, numPartitions == 0 if all taps are convolved directly
+  hv_uint32_t numPartitions;
+  hv_uint32_t blockIndex; // the number of samples processed in the current partition
+  hv_uint32_t fdlIndex;   // the most recent input spectrum in the delay line
+  float *spectra;  // partition spectra of the coefficients
+  float *fdl;      // frequency-domain delay line of input spectra
+  float *tailOut;  // the tail contribution to the current partition block
+  float *fftRe;    // fft scratch
+  float *fftIm;
+  float *twiddles; // cos and sin tables
 } SignalConvolution;
 
 hv_size_t sConv_init(SignalConvolution *o, struct HvTable *coeffs, const int size);
@@ -33,31 +63,6 @@ void sConv_free(SignalConvolution *o);
 void sConv_onMessage(HvBase *_c, SignalConvolution *o, int letIndex,
     const HvMessage *const m, void *sendMessage);
 
-static inline void __hv_conv_f(SignalConvolution *o, hv_bInf_t bIn, hv_bOutf_t bOut) {
-  hv_assert(o->table != NULL);
-  hv_assert(hTable_getSize(&o->inputs) <= hTable_getSize(o->table));
-
-#if HV_SIMD_AVX
-#warning __hv_conv_f() not implemented
-  *bOut = bIn; // TODO(mhroth): for now pass through the input
-#elif HV_SIMD_SSE
-#warning __hv_conv_f() not implemented
-  *bOut = bIn; // TODO(mhroth): for now pass through the input
-#elif HV_SIMD_NEON
-#warning __hv_conv_f() not implemented
-  *bOut = bIn; // TODO(mhroth): for now pass through the input
-#else // HV_SIMD_NONE
-  const hv_uint32_t s = hTable_getSize(&o->inputs) - 1;
-  float *const inputs = hTable_getBuffer(&o->inputs);
-  hv_memcpy(inputs, inputs+1, s*sizeof(float));
-  inputs[s] = bIn;
-  const float *const coeffs = hTable_getBuffer(o->table);
-  float f = 0.0f;
-  for (int i = 0; i <= s; ++i) {
-    f = hv_fma_f(inputs[s-i], coeffs[i], f);
-  }
-  *bOut = f;
-#endif
-}
+void __hv_conv_f(SignalConvolution *o, hv_bInf_t bIn, hv_bOutf_t bOut);
 
 #endif // _SIGNAL_CONVOLUTION_H_
@@ -30,41 +30,52 @@ hv_size_t sEnv_init(SignalEnvelope *o, int windowSize, int period) {
 	o->windowSize = (windowSize <= HV_N_SIMD) ? HV_N_SIMD : ceilToNearestBlock(windowSize, HV_N_SIMD);
 	o->period = (period <= HV_N_SIMD) ? HV_N_SIMD : (period > o->windowSize) ? o->windowSize : ceilToNearestBlock(period, HV_N_SIMD);
 	o->numSamplesInBuffer = 0;
+	o->blockIndex = 0;
   hv_size_t numBytes = 0;
 
-	// allocate the signal buffer
-	// the buffer is overdimensioned in this way (up to double), but not by much and so what
-	const int bufferLength = 2 * o->windowSize;
-	o->buffer = (float *) hv_malloc(bufferLength*sizeof(float));
-  numBytes += bufferLength*sizeof(float);
-
-	// allocate and calculate the hanning weights
-	o->hanningWeights = (float *) hv_malloc(o->windowSize*sizeof(float));
-  numBytes += o->windowSize*sizeof(float);
-	float hanningSum = 0.0f;
-	for (int i = 0; i < o->windowSize; i++) {
-		const float w = 0.5f * (1.0f - cosf(((float) (2.0 * M_PI * i)) / ((float) (o->windowSize - 1))));
-		o->hanningWeights[i] = w;
-		hanningSum += w;
-	}
-	for (int i = 0; i < o->windowSize; i++) {
-		// normalise the hanning coefficients such that they represent a normalised weighted averaging
-		o->hanningWeights[i] /= hanningSum;
+	// the contribution of each block in the window, such that it can be removed again
+	const int numBlocks = o->windowSize / HV_N_SIMD;
+	o->blocks = (double *) hv_malloc(3*numBlocks*sizeof(double));
+	hv_memclear(o->blocks, 3*numBlocks*sizeof(double));
+  numBytes += 3*numBlocks*sizeof(double);
+	o->sum = 0.0;
+	o->re = 0.0;
+	o->im = 0.0;
+
+	// the hanning window completes one period over windowSize-1 samples
+	const double w = 2.0 * M_PI / (double) (o->windowSize - 1);
+	o->phasors = (float *) hv_malloc(2*HV_N_SIMD*sizeof(float));
+  numBytes += 2*HV_N_SIMD*sizeof(float);
+	for (int i = 0; i < HV_N_SIMD; i++) {
+		// the phase of each lane relative to the last sample of the block
+		o->phasors[i] = (float) cos(w * (i+1-HV_N_SIMD));
+		o->phasors[i+HV_N_SIMD] = (float) sin(w * (i+1-HV_N_SIMD));
 	}
+	o->rotBlock[0] = cos(w * HV_N_SIMD);
+	o->rotBlock[1] = -sin(w * HV_N_SIMD);
+	o->rotWindow[0] = cos(w * o->windowSize);
+	o->rotWindow[1] = -sin(w * o->windowSize);
+
+	// normalise the hanning coefficients such that they represent a normalised weighted averaging
+	o->hanningSum = 0.5 * (o->windowSize - 1);
 
   return numBytes;
 }
 
 void sEnv_free(SignalEnvelope *o) {
-	hv_free(o->hanningWeights);
-	hv_free(o->buffer);
+	hv_free(o->phasors);
+	hv_free(o->blocks);
 }
 
-static void sEnv_sendMessage(HvBase *_c, SignalEnvelope *o, float rms,
+static void sEnv_sendMessage(HvBase *_c, SignalEnvelope *o,
     void (*sendMessage)(HvBase *, int, const HvMessage *)) {
+  // hann weighted mean power of the window
+  const float power = (float) ((0.5*o->sum - 0.5*o->re) / o->hanningSum);
+
   // finish RMS calculation. sqrt is removed as it can be combined with the log operation.
-  // result is normalised such that 1 RMS == 100 dB
-  rms = 10.0f * log10f(rms) + 100.0f;
+  // result is normalised such that 1 RMS == 100 dB. Anything below 0 dB is clamped
+  // before the log, as -ffast-math does not handle log10f(0).
+  const float rms = (power > 1e-10f) ? (10.0f * log10f(power) + 100.0f) : 0.0f;
 
   // prepare the outgoing message. Schedule it at the beginning of the next block.
   HvMessage *const m = HV_MESSAGE_ON_STACK(1);
@@ -72,74 +83,54 @@ static void sEnv_sendMessage(HvBase *_c, SignalEnvelope *o, float rms,
   msg_initWithFloat(m, ctx_getBlockStartTimestamp(_c) + HV_N_SIMD, (rms < 0.0f) ? 0.0f : rms);
   ctx_scheduleMessage(Base(_c), m, sendMessage, 0);
 
-  hv_memcpy(o->buffer, o->buffer+o->period, sizeof(float)*(o->numSamplesInBuffer - o->period));
   o->numSamplesInBuffer -= o->period;
 }
 
+// adds the contribution of a new block to the window and removes the oldest one
+static inline void sEnv_slide(SignalEnvelope *o, double sum, double re, double im) {
+  double *const b = o->blocks + 3*o->blockIndex;
+  const double r = o->rotBlock[0]*o->re - o->rotBlock[1]*o->im;
+  const double i = o->rotBlock[0]*o->im + o->rotBlock[1]*o->re;
+  o->re = r - (o->rotWindow[0]*b[1] - o->rotWindow[1]*b[2]) + re;
+  o->im = i - (o->rotWindow[0]*b[2] + o->rotWindow[1]*b[1]) + im;
+  o->sum += sum - b[0];
+  b[0] = sum;
+  b[1] = re;
+  b[2] = im;
+  if (++o->blockIndex == o->windowSize/HV_N_SIMD) o->blockIndex = 0;
+}
+
 void sEnv_process(HvBase *_c, SignalEnvelope *o, hv_bInf_t bIn,
 		void (*sendMessage)(HvBase *, int, const HvMessage *)) {
 #if HV_SIMD_AVX
-  _mm256_stream_ps(o->buffer+o->numSamplesInBuffer, _mm256_mul_ps(bIn,bIn)); // store bIn^2, no need to cache block
-  o->numSamplesInBuffer += HV_N_SIMD;
-
-  if (o->numSamplesInBuffer >= o->windowSize) {
-    int n4 = o->windowSize & ~HV_N_SIMD_MASK;
-    __m256 sum = _mm256_setzero_ps();
-    while (n4) {
-      __m256 x = _mm256_load_ps(o->buffer + n4 - HV_N_SIMD);
-      __m256 h = _mm256_load_ps(o->hanningWeights + n4 - HV_N_SIMD);
-      x = _mm256_mul_ps(x, h);
-      sum = _mm256_add_ps(sum, x);
-      n4 -= HV_N_SIMD;
-    }
-    sum = _mm256_hadd_ps(sum,sum); // horizontal sum
-    sum = _mm256_hadd_ps(sum,sum);
-    sEnv_sendMessage(_c, o, sum[0]+sum[4], sendMessage); // updates numSamplesInBuffer
-  }
+  __m256 p = _mm256_mul_ps(bIn,bIn);
+  __m256 c = _mm256_mul_ps(p, _mm256_load_ps(o->phasors));
+  __m256 s = _mm256_mul_ps(p, _mm256_load_ps(o->phasors+HV_N_SIMD));
+  __m256 a = _mm256_hadd_ps(p, c); // horizontal sums of p, c and s
+  __m256 b = _mm256_hadd_ps(s, _mm256_setzero_ps());
+  a = _mm256_hadd_ps(a, b);
+  __m128 t = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+  sEnv_slide(o, t[0], t[1], t[2]);
 #elif HV_SIMD_SSE
-  _mm_stream_ps(o->buffer+o->numSamplesInBuffer, _mm_mul_ps(bIn,bIn)); // store bIn^2, no need to cache block
-  o->numSamplesInBuffer += HV_N_SIMD;
-
-  if (o->numSamplesInBuffer >= o->windowSize) {
-    int n4 = o->windowSize & ~HV_N_SIMD_MASK;
-    __m128 sum = _mm_setzero_ps();
-    while (n4) {
-      __m128 x = _mm_load_ps(o->buffer + n4 - HV_N_SIMD);
-      __m128 h = _mm_load_ps(o->hanningWeights + n4 - HV_N_SIMD);
-      x = _mm_mul_ps(x, h);
-      sum = _mm_add_ps(sum, x);
-      n4 -= HV_N_SIMD;
-    }
-    sum = _mm_hadd_ps(sum,sum); // horizontal sum
-    sum = _mm_hadd_ps(sum,sum);
-    sEnv_sendMessage(_c, o, sum[0], sendMessage);
-  }
+  __m128 p = _mm_mul_ps(bIn,bIn);
+  __m128 c = _mm_mul_ps(p, _mm_load_ps(o->phasors));
+  __m128 s = _mm_mul_ps(p, _mm_load_ps(o->phasors+HV_N_SIMD));
+  __m128 a = _mm_hadd_ps(p, c); // horizontal sums of p, c and s
+  __m128 b = _mm_hadd_ps(s, s);
+  a = _mm_hadd_ps(a, b);
+  sEnv_slide(o, a[0], a[1], a[2]);
 #elif HV_SIMD_NEON
-  vst1q_f32(o->buffer+o->numSamplesInBuffer, vmulq_f32(bIn,bIn)); // store bIn^2, no need to cache block
-  o->numSamplesInBuffer += HV_N_SIMD;
-
-  if (o->numSamplesInBuffer >= o->windowSize) {
-    int n4 = o->windowSize & ~HV_N_SIMD_MASK;
-    float32x4_t sum = vdupq_n_f32(0.0f);
-    while (n4) {
-      float32x4_t x = vld1q_f32(o->buffer + n4 - HV_N_SIMD);
-      float32x4_t h = vld1q_f32(o->hanningWeights + n4 - HV_N_SIMD);
-      x = vmulq_f32(x, h);
-      sum = vaddq_f32(sum, x);
-      n4 -= HV_N_SIMD;
-    }
-    sEnv_sendMessage(_c, o, sum[0]+sum[1]+sum[2]+sum[3], sendMessage);
-  }
+  float32x4_t p = vmulq_f32(bIn,bIn);
+  float32x4_t c = vmulq_f32(p, vld1q_f32(o->phasors));
+  float32x4_t s = vmulq_f32(p, vld1q_f32(o->phasors+HV_N_SIMD));
+  sEnv_slide(o, p[0]+p[1]+p[2]+p[3], c[0]+c[1]+c[2]+c[3], s[0]+s[1]+s[2]+s[3]);
 #else // HV_SIMD_NONE
-  o->buffer[o->numSamplesInBuffer] = (bIn*bIn);
+  const float p = bIn*bIn;
+  sEnv_slide(o, p, p*o->phasors[0], p*o->phasors[1]);
+#endif
   o->numSamplesInBuffer += HV_N_SIMD;
 
   if (o->numSamplesInBuffer >= o->windowSize) {
-    float sum = 0.0f;
-    for (int i = 0; i < o->windowSize; ++i) {
-      sum += (o->hanningWeights[i] * o->buffer[i]);
-    }
-    sEnv_sendMessage(_c, o, sum, sendMessage);
+    sEnv_sendMessage(_c, o, sendMessage); // updates numSamplesInBuffer
   }
-#endif
 }
@@ -19,12 +19,24 @@
 
 #include "HvBase.h"
 
+// The Hann-weighted power over the window is kept as a sliding sum. With
+// w[i] = 0.5 - 0.5*cos(2*pi*i/(N-1)) the weighted sum is 0.5*sum(x^2) minus
+// 0.5*real(X), where X is the sliding DFT of x^2 at bin 1/(N-1). Each block
+// of HV_N_SIMD samples adds its contribution to both sums and removes that of
+// the block leaving the window, so the cost per sample is constant.
 typedef struct SignalEnvelope {
 	int windowSize;
 	int period;
 	int numSamplesInBuffer;
-	float *hanningWeights;
-	float *buffer;
+	int blockIndex; // the oldest block in the window
+	float *phasors; // the cos and sin weights of each lane within a block
+	double *blocks; // the sum, real and imaginary contribution of each block in the window
+	double sum;
+	double re;
+	double im;
+	double rotBlock[2]; // rotation of the sliding dft over one block
+	double rotWindow[2]; // rotation of the sliding dft over the whole window
+	double hanningSum;
 } SignalEnvelope;
 
 hv_size_t sEnv_init(SignalEnvelope *o, int windowSize, int period);
@@ -50,3 +50,8 @@ hv_size_t sRPole_init(SignalRPole *o) {
 void sRPole_onMessage(HvBase *_c, SignalRPole *o, int letIn, const HvMessage *m) {
   // TODO
 }
+
+hv_size_t sRPoleBank_init(SignalRPoleBank *o) {
+  __hv_zero_f(&o->ym);
+  return 0;
+}
@@ -120,4 +120,40 @@ static inline void __hv_rpole_f(SignalRPole *o, hv_bInf_t bIn0, hv_bInf_t bIn1,
 #endif
 }
 
+// A bank of independent rpole~ filters, one channel per SIMD lane. The
+// recursion runs across channels rather than across time, so no chain of
+// SignalDel1 is needed.
+typedef struct SignalRPoleBank {
+  hv_bufferf_t ym;
+} SignalRPoleBank;
+
+hv_size_t sRPoleBank_init(SignalRPoleBank *o);
+
+// filters one frame, one channel per lane
+static inline void __hv_rpole_bank_f(SignalRPoleBank *o, hv_bInf_t bIn0, hv_bInf_t bIn1, hv_bOutf_t bOut) {
+  hv_bufferf_t a;
+  __hv_mul_f(bIn1, o->ym, &a);
+  __hv_sub_f(bIn0, a, &a);
+  o->ym = a;
+  *bOut = a;
+}
+
+// filters one buffer of each of HV_N_SIMD channels. bIn0, bIn1 and bOut are
+// arrays of HV_N_SIMD buffers, one per channel.
+static inline void __hv_rpole_bank_block_f(SignalRPoleBank *o,
+    const hv_bufferf_t *bIn0, const hv_bufferf_t *bIn1, hv_bufferf_t *bOut) {
+  hv_bufferf_t x[HV_N_SIMD], a[HV_N_SIMD];
+  for (int i = 0; i < HV_N_SIMD; ++i) {
+    x[i] = bIn0[i];
+    a[i] = bIn1[i];
+  }
+  __hv_transpose_f(x);
+  __hv_transpose_f(a);
+  for (int i = 0; i < HV_N_SIMD; ++i) {
+    __hv_rpole_bank_f(o, x[i], a[i], x+i);
+  }
+  __hv_transpose_f(x);
+  for (int i = 0; i < HV_N_SIMD; ++i) bOut[i] = x[i];
+}
+
 #endif // _SIGNAL_RPOLE_H_
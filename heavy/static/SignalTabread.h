@@ -19,6 +19,7 @@
 
 #include "HvBase.h"
 #include "HvTable.h"
+#include "HvMath.h"
 
 typedef struct SignalTabread {
   HvTable *table; // the table to read
@@ -49,7 +50,12 @@ static inline void __hv_tabread_if(SignalTabread *o, hv_bIni_t bIn, hv_bOutf_t b
   hv_assert(i[6] >= 0 && i[6] < hTable_getAllocated(o->table));
   hv_assert(i[7] >= 0 && i[7] < hTable_getAllocated(o->table));
 
-  *bOut = _mm_set_ps(b[i[7]], b[i[6]], b[i[5]], b[i[4]], b[i[3]], b[i[2]], b[i[1]], b[i[0]]);
+#if HV_SIMD_AVX2
+  (void) i; // only read by the asserts, which NDEBUG removes
+  *bOut = _mm256_i32gather_ps(b, bIn, sizeof(float));
+#else
+  *bOut = _mm256_set_ps(b[i[7]], b[i[6]], b[i[5]], b[i[4]], b[i[3]], b[i[2]], b[i[1]], b[i[0]]);
+#endif
 #elif HV_SIMD_SSE
   const hv_int32_t *const i = (hv_int32_t *) &bIn;
 
@@ -74,6 +80,87 @@ static inline void __hv_tabread_if(SignalTabread *o, hv_bIni_t bIn, hv_bOutf_t b
 }
 
 
+#if HV_APPLE
+#pragma mark - Tabread - Cubic Interpolation
+#endif
+
+// 4-point cubic interpolating random access, as tabread4~ in Pd. The index is
+// clamped to [1, length-2] such that all four points lie within the table.
+static inline void __hv_tabread4_f(SignalTabread *o, hv_bInf_t bIn, hv_bOutf_t bOut) {
+  const float *const buf = hTable_getBuffer(o->table);
+  const hv_uint32_t n = hTable_getLength(o->table);
+  if (n < 4) {
+    __hv_zero_f(bOut);
+    return;
+  }
+
+  // split the index into integer and fractional parts
+  hv_bufferf_t x, k, f;
+  __hv_max_f(bIn, __hv_splat_f(1.0f), &x);
+  __hv_min_f(x, __hv_splat_f((float) (n-2)), &x);
+  __hv_floor_f(x, &k);
+  __hv_min_f(k, __hv_splat_f((float) (n-3)), &k);
+  __hv_sub_f(x, k, &f);
+
+  // fetch the four points around each index
+  hv_bufferf_t a, b, c, d;
+#if HV_SIMD_AVX2
+  const __m256i i = _mm256_cvttps_epi32(k);
+  a = _mm256_i32gather_ps(buf-1, i, sizeof(float));
+  b = _mm256_i32gather_ps(buf, i, sizeof(float));
+  c = _mm256_i32gather_ps(buf+1, i, sizeof(float));
+  d = _mm256_i32gather_ps(buf+2, i, sizeof(float));
+#elif HV_SIMD_AVX
+  // load the four points of each lane and transpose
+  const __m256i j = _mm256_cvttps_epi32(k);
+  const hv_int32_t *const i = (hv_int32_t *) &j;
+  __m128 p0 = _mm_loadu_ps(buf+i[0]-1);
+  __m128 p1 = _mm_loadu_ps(buf+i[1]-1);
+  __m128 p2 = _mm_loadu_ps(buf+i[2]-1);
+  __m128 p3 = _mm_loadu_ps(buf+i[3]-1);
+  __m128 p4 = _mm_loadu_ps(buf+i[4]-1);
+  __m128 p5 = _mm_loadu_ps(buf+i[5]-1);
+  __m128 p6 = _mm_loadu_ps(buf+i[6]-1);
+  __m128 p7 = _mm_loadu_ps(buf+i[7]-1);
+  _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+  _MM_TRANSPOSE4_PS(p4, p5, p6, p7);
+  a = _mm256_insertf128_ps(_mm256_castps128_ps256(p0), p4, 1);
+  b = _mm256_insertf128_ps(_mm256_castps128_ps256(p1), p5, 1);
+  c = _mm256_insertf128_ps(_mm256_castps128_ps256(p2), p6, 1);
+  d = _mm256_insertf128_ps(_mm256_castps128_ps256(p3), p7, 1);
+#elif HV_SIMD_SSE || HV_SIMD_NEON
+  // load the four points of each lane and transpose
+  hv_bufferi_t j;
+  __hv_cast_fi(k, &j);
+  const hv_int32_t *const i = (hv_int32_t *) &j;
+  hv_bufferf_t p[4];
+  __hv_loadu_f(buf+i[0]-1, p+0);
+  __hv_loadu_f(buf+i[1]-1, p+1);
+  __hv_loadu_f(buf+i[2]-1, p+2);
+  __hv_loadu_f(buf+i[3]-1, p+3);
+  __hv_transpose_f(p);
+  a = p[0]; b = p[1]; c = p[2]; d = p[3];
+#else // HV_SIMD_NONE
+  const hv_int32_t i = (hv_int32_t) k;
+  a = buf[i-1]; b = buf[i]; c = buf[i+1]; d = buf[i+2];
+#endif
+
+  // b + f*((c-b) - (1-f)/6 * ((d-a-3(c-b))*f + (d+2a-3b)))
+  hv_bufferf_t cb, t, u, g;
+  __hv_sub_f(c, b, &cb);
+  __hv_sub_f(d, a, &t);
+  __hv_fma_f(cb, __hv_splat_f(-3.0f), t, &t);
+  __hv_fma_f(a, __hv_splat_f(2.0f), d, &u);
+  __hv_fma_f(b, __hv_splat_f(-3.0f), u, &u);
+  __hv_fma_f(t, f, u, &t);
+  __hv_sub_f(__hv_splat_f(1.0f), f, &g);
+  __hv_mul_f(g, __hv_splat_f(1.0f/6.0f), &g);
+  __hv_mul_f(g, t, &t);
+  __hv_sub_f(cb, t, &t);
+  __hv_fma_f(f, t, b, bOut);
+}
+
+
 
 #if HV_APPLE
 #pragma mark - Tabread - Linear Access
@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2014,2015,2016 Enzien Audio Ltd.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "SignalWavetable.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846 // in case math.h doesn't include this defintion
+#endif
+
+static struct {
+  HvTable levels[HV_WAVETABLE_NUM_LEVELS];
+  hv_uint32_t numLevels;
+  int refCount;
+} sWavetable_shared[HV_WAVETABLE_NUM_SHAPES];
+
+// Guards the shared tables, as contexts may be created and freed on any thread.
+// It is only taken by init and free, never while processing, so a spin lock
+// does not hold up the audio thread.
+static void *sWavetable_lock = NULL;
+
+static void sWavetable_acquire() {
+  while (!hv_atomic_cas_ptr(&sWavetable_lock, NULL, &sWavetable_lock));
+}
+
+static void sWavetable_release() {
+  hv_atomic_store_ptr(&sWavetable_lock, NULL);
+}
+
+// additive synthesis of one period with all harmonics up to maxHarmonic
+static void sWavetable_fill(float *t, const double *sinTable, HvWavetableShape shape, hv_uint32_t maxHarmonic) {
+  const hv_uint32_t mask = HV_WAVETABLE_SIZE-1;
+  for (hv_uint32_t n = 0; n < HV_WAVETABLE_SIZE; ++n) {
+    double y = 0.0;
+    switch (shape) {
+      case HV_WAVETABLE_COS: {
+        y = sinTable[(n + HV_WAVETABLE_SIZE/4) & mask];
+        break;
+      }
+      case HV_WAVETABLE_SAW: {
+        for (hv_uint32_t k = 1; k <= maxHarmonic; ++k) y -= sinTable[(k*n) & mask] / k;
+        y *= 2.0 / M_PI;
+        break;
+      }
+      case HV_WAVETABLE_SQUARE: {
+        for (hv_uint32_t k = 1; k <= maxHarmonic; k += 2) y += sinTable[(k*n) & mask] / k;
+        y *= 4.0 / M_PI;
+        break;
+      }
+      default: break;
+    }
+    t[n] = (float) y;
+  }
+
+  // the guard samples repeat the start of the table, for interpolation across the end
+  hv_memcpy(t+HV_WAVETABLE_SIZE, t, HV_N_SIMD*sizeof(float));
+}
+
+hv_size_t sWavetable_init(SignalWavetable *o, HvWavetableShape shape, double samplerate) {
+  hv_assert(shape >= 0 && shape < HV_WAVETABLE_NUM_SHAPES);
+  hv_size_t numBytes = 0;
+  sWavetable_acquire();
+  if (sWavetable_shared[shape].refCount++ == 0) {
+    double *sinTable = (double *) hv_malloc(HV_WAVETABLE_SIZE*sizeof(double));
+    for (int i = 0; i < HV_WAVETABLE_SIZE; ++i) {
+      sinTable[i] = sin(2.0 * M_PI * i / HV_WAVETABLE_SIZE);
+    }
+
+    // a sinusoid is band-limited at any frequency
+    const hv_uint32_t numLevels = (shape == HV_WAVETABLE_COS) ? 1 : HV_WAVETABLE_NUM_LEVELS;
+    for (hv_uint32_t i = 0; i < numLevels; ++i) {
+      HvTable *const table = sWavetable_shared[shape].levels + i;
+      numBytes += hTable_init(table, HV_WAVETABLE_SIZE);
+      sWavetable_fill(hTable_getBuffer(table), sinTable, shape, (HV_WAVETABLE_SIZE/2) >> i);
+    }
+    sWavetable_shared[shape].numLevels = numLevels;
+    hv_free(sinTable);
+  }
+
+  o->levels = sWavetable_shared[shape].levels;
+  o->numLevels = sWavetable_shared[shape].numLevels;
+  sWavetable_release();
+  o->shape = shape;
+  o->f2l = (float) (HV_WAVETABLE_SIZE / samplerate);
+  return numBytes;
+}
+
+void sWavetable_free(SignalWavetable *o) {
+  sWavetable_acquire();
+  if (--sWavetable_shared[o->shape].refCount == 0) {
+    for (hv_uint32_t i = 0; i < sWavetable_shared[o->shape].numLevels; ++i) {
+      hTable_free(sWavetable_shared[o->shape].levels + i);
+    }
+    sWavetable_shared[o->shape].numLevels = 0;
+  }
+  sWavetable_release();
+  o->levels = NULL;
+}
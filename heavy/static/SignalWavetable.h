@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2014,2015,2016 Enzien Audio Ltd.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef _HEAVY_SIGNAL_WAVETABLE_H_
+#define _HEAVY_SIGNAL_WAVETABLE_H_
+
+#include "HvBase.h"
+#include "HvTable.h"
+#include "HvMath.h"
+
+// the number of samples in one period of each table, a power of two
+#define HV_WAVETABLE_SIZE 2048
+
+// one band-limited level per octave, from HV_WAVETABLE_SIZE/2 harmonics down to one
+#define HV_WAVETABLE_NUM_LEVELS 11
+
+typedef enum HvWavetableShape {
+  HV_WAVETABLE_COS,    // cos(2*pi*phase), as osc~
+  HV_WAVETABLE_SAW,    // rising from -1 to 1 over the period
+  HV_WAVETABLE_SQUARE, // 1 over the first half of the period, -1 over the second
+  HV_WAVETABLE_NUM_SHAPES
+} HvWavetableShape;
+
+// A band-limited wavetable oscillator. The tables of each shape are built once
+// and shared read-only by all contexts, which may be created and freed on any
+// thread.
+typedef struct SignalWavetable {
+  HvTable *levels;
+  hv_uint32_t numLevels;
+  HvWavetableShape shape;
+  float f2l; // frequency to level scale, HV_WAVETABLE_SIZE/samplerate
+} SignalWavetable;
+
+hv_size_t sWavetable_init(SignalWavetable *o, HvWavetableShape shape, double samplerate);
+
+void sWavetable_free(SignalWavetable *o);
+
+// Reads the table at phase bPhase, in [0,1), with linear interpolation. The
+// level is chosen once per buffer from the frequency in the first lane of
+// bFreq, such that no harmonic lies above Nyquist. bFreq is ignored for
+// HV_WAVETABLE_COS, which has only one level.
+static inline void __hv_wavetable_f(SignalWavetable *o, hv_bInf_t bPhase, hv_bInf_t bFreq, hv_bOutf_t bOut) {
+  hv_uint32_t level = 0;
+  if (o->numLevels > 1) {
+#if HV_SIMD_NONE
+    const float r = hv_abs_f(bFreq) * o->f2l;
+#else
+    const float r = hv_abs_f(bFreq[0]) * o->f2l;
+#endif
+    if (r > 1.0f) {
+      int e;
+      frexpf(r, &e); // r < 2^e
+      level = hv_min_ui((hv_uint32_t) e, o->numLevels-1);
+    }
+  }
+  const float *const t = hTable_getBuffer(o->levels + level);
+
+  // split the table index into integer and fractional parts. The phase is
+  // never negative, so truncation is the floor.
+  hv_bufferf_t x, f, a, b;
+  __hv_mul_f(bPhase, __hv_splat_f((float) HV_WAVETABLE_SIZE), &x);
+
+  // fetch the two points around each index. The guard samples after the
+  // table repeat its start.
+#if HV_SIMD_AVX2
+  __m256i i = _mm256_cvttps_epi32(x);
+  f = _mm256_sub_ps(x, _mm256_cvtepi32_ps(i));
+  i = _mm256_and_si256(i, _mm256_set1_epi32(HV_WAVETABLE_SIZE-1));
+  a = _mm256_i32gather_ps(t, i, sizeof(float));
+  b = _mm256_i32gather_ps(t+1, i, sizeof(float));
+#elif HV_SIMD_AVX
+  const __m256i j = _mm256_cvttps_epi32(x);
+  f = _mm256_sub_ps(x, _mm256_cvtepi32_ps(j));
+  const hv_int32_t *const i = (hv_int32_t *) &j;
+  const hv_int32_t m = HV_WAVETABLE_SIZE-1;
+  a = _mm256_set_ps(t[i[7]&m], t[i[6]&m], t[i[5]&m], t[i[4]&m], t[i[3]&m], t[i[2]&m], t[i[1]&m], t[i[0]&m]);
+  b = _mm256_set_ps(t[(i[7]&m)+1], t[(i[6]&m)+1], t[(i[5]&m)+1], t[(i[4]&m)+1],
+      t[(i[3]&m)+1], t[(i[2]&m)+1], t[(i[1]&m)+1], t[(i[0]&m)+1]);
+#elif HV_SIMD_SSE
+  __m128i j = _mm_cvttps_epi32(x);
+  f = _mm_sub_ps(x, _mm_cvtepi32_ps(j));
+  j = _mm_and_si128(j, _mm_set1_epi32(HV_WAVETABLE_SIZE-1));
+  __m128 p0 = _mm_castpd_ps(_mm_load_sd((const double *) (t+_mm_cvtsi128_si32(j))));
+  __m128 p1 = _mm_castpd_ps(_mm_load_sd((const double *) (t+_mm_extract_epi32(j, 1))));
+  __m128 p2 = _mm_castpd_ps(_mm_load_sd((const double *) (t+_mm_extract_epi32(j, 2))));
+  __m128 p3 = _mm_castpd_ps(_mm_load_sd((const double *) (t+_mm_extract_epi32(j, 3))));
+  __m128 p01 = _mm_unpacklo_ps(p0, p1); // a0 a1 b0 b1
+  __m128 p23 = _mm_unpacklo_ps(p2, p3); // a2 a3 b2 b3
+  a = _mm_movelh_ps(p01, p23);
+  b = _mm_movehl_ps(p23, p01);
+#elif HV_SIMD_NEON
+  int32x4_t j = vcvtq_s32_f32(x);
+  f = vsubq_f32(x, vcvtq_f32_s32(j));
+  j = vandq_s32(j, vdupq_n_s32(HV_WAVETABLE_SIZE-1));
+  float32x2_t p0 = vld1_f32(t+vgetq_lane_s32(j, 0));
+  float32x2_t p1 = vld1_f32(t+vgetq_lane_s32(j, 1));
+  float32x2_t p2 = vld1_f32(t+vgetq_lane_s32(j, 2));
+  float32x2_t p3 = vld1_f32(t+vgetq_lane_s32(j, 3));
+  float32x2x2_t p01 = vtrn_f32(p0, p1); // {a0 a1} {b0 b1}
+  float32x2x2_t p23 = vtrn_f32(p2, p3);
+  a = vcombine_f32(p01.val[0], p23.val[0]);
+  b = vcombine_f32(p01.val[1], p23.val[1]);
+#else // HV_SIMD_NONE
+  const hv_int32_t i = (hv_int32_t) x;
+  f = x - (float) i;
+  a = t[i & (HV_WAVETABLE_SIZE-1)];
+  b = t[(i & (HV_WAVETABLE_SIZE-1)) + 1];
+#endif
+
+  __hv_sub_f(b, a, &b);
+  __hv_fma_f(f, b, a, bOut);
+}
+
+#endif // _HEAVY_SIGNAL_WAVETABLE_H_
@@ -1,19 +1,31 @@
 /* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
 
-#include <alsa/asoundlib.h> // alsa
 #include <arpa/inet.h>      // network
+#include <assert.h>
 #include <pthread.h>        // threads
 #include <sys/socket.h>     // sockets
 #include <stdio.h>
 #include <sys/time.h>
 #include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>         // close
 #include <ifaddrs.h>
 #include <sys/stat.h>       // stat
 
 #include "tinyosc/tinyosc.h" // OSC support
 #include "oscbuffer.h"
+#include "voicepool.h"
+#include "audioring.h"
+#include "governor.h"
+#include "audiobackend.h"
+#include "osctransport.h"
+#include "controlring.h"
+#include "eventbus.h"
+#include "coalescer.h"
+#include "midiinput.h"
 
 // heavy
 #include "heavy/slot0/Heavy_slot0.h"
@@ -24,16 +36,69 @@
 #define BLOCK_SIZE 256
 #define NUM_OUTPUT_CHANNELS 2
 
-#define ALSA_DEVICE "sysdefault:CARD=sndrpihifiberry"
+#define DEFAULT_AUDIO_BACKEND "alsa:sysdefault:CARD=sndrpihifiberry"
+#define NUM_SLOTS 2
+#define NUM_VOICES_PER_SLOT 4
+
+// Blocks in the ring, 0 renders in the device thread. The device thread holds
+// one block while writing it, so the dsp thread renders depth-1 blocks ahead.
+#define DEFAULT_RING_DEPTH 2
+#define DEFAULT_NUM_PERIODS 1 // device buffer size in blocks
+#define MAX_BUNDLE_MESSAGES 64 // in one packet, including nested bundles
+#define MAX_BUNDLE_DEPTH 8
+
+#define OSC_UDP_PORT 9000
+#define DEFAULT_OSC_TCP_PORT 9000
+#define DEFAULT_OSC_UNIX_SOCKET "/tmp/harpy.osc"
+
+#define DEFAULT_CONTROL_RING "/harpy" // shared memory name
+#define CONTROL_RING_CAPACITY 1024 // events
+#define MAX_CONTROL_EVENTS_PER_LOCK 64
+
+#define EVENT_BUS_CAPACITY 4096 // events
+
+#define DEFAULT_COALESCE_BLOCKS 1 // only the newest value of a control is sent in this window
 
 static volatile bool _keepRunning = true;
 
+typedef struct Modules Modules;
+
+// identifies the context which called the send hook
 typedef struct {
-  void *mods[4];
+  Modules *modules;
+  int8_t slot; // -1 for the mixer
+  int8_t voice;
+} SendSource;
+
+struct Modules {
+  VoicePool slots[NUM_SLOTS];
   void *mixer;
+  float *slotBuffers[NUM_SLOTS*NUM_OUTPUT_CHANNELS]; // the output of each slot
+  AudioRing ring; // blocks rendered ahead by the dsp thread
+  Governor governor; // sheds polyphony when rendering nears the block period
   OscBuffer oscBuffer;
+  OscTransport transport; // all of the sockets on which OSC is received
+  ControlRing control; // pre-decoded events from local processes
+  bool hasControl;
+  EventBus bus; // messages sent by the patches, on their way out to subscribers
+  SendSource sources[NUM_SLOTS*NUM_VOICES_PER_SLOT+1];
+  Coalescer coalescer; // the newest values of the controls changed in this window
+  int coalesceBlocks; // the length of the window, 0 if values are not coalesced
+  int blocksToFlush;
+  MidiInput midi; // a MIDI device read in-process, without going through OSC
+  bool hasMidi;
+  struct timespec blockStart; // the time at which the last block started rendering
+  _Atomic int64_t replaySample; // where a patch asked to restart the clip, or -1
+  uint64_t numBlocksRendered; // the audio clock, which all contexts follow
   pthread_mutex_t lock;
-} Modules;
+};
+
+// the decoded messages of one OSC packet, each with its effective timetag
+typedef struct {
+  tosc_decoded messages[MAX_BUNDLE_MESSAGES];
+  uint64_t timetags[MAX_BUNDLE_MESSAGES];
+  int numMessages;
+} OscPacket;
 
 // forward function declarations
 static void handleOscBuffer(char *buffer, int len, Modules *m);
@@ -53,24 +118,74 @@ static void timespec_subtract(struct timespec *result, struct timespec *end, str
   }
 }
 
+// voice functions for each slot patch
+static Heavy *slot0_new(double sampleRate) { return hv_slot0_new(sampleRate); }
+static int slot0_process(Heavy *c, float **inputBuffers, float **outputBuffers, int n) {
+  return hv_slot0_process((Hv_slot0 *) c, inputBuffers, outputBuffers, n);
+}
+static void slot0_free(Heavy *c) { hv_slot0_free((Hv_slot0 *) c); }
+
+static Heavy *slot1_new(double sampleRate) { return hv_slot1_new(sampleRate); }
+static int slot1_process(Heavy *c, float **inputBuffers, float **outputBuffers, int n) {
+  return hv_slot1_process((Hv_slot1 *) c, inputBuffers, outputBuffers, n);
+}
+static void slot1_free(Heavy *c) { hv_slot1_free((Hv_slot1 *) c); }
+
+static const VoiceContextFunctions SLOT_FUNCTIONS[NUM_SLOTS] = {
+  {&slot0_new, &slot0_process, &slot0_free},
+  {&slot1_new, &slot1_process, &slot1_free}
+};
+
 static void hv_printHook(
     double timestamp, const char *name, const char *s, void *userData) {
   printf("[%.3fms] %s: %s\n", timestamp, name, s);
 }
 
+// Records that a patch asked for the clip to be restarted, at the given time.
+// Every voice of a slot sends it, possibly on different threads, and the
+// earliest request of the block is kept.
+static void requestReplay(Modules *m, double timestamp) {
+  const int64_t sample = (int64_t) (timestamp*SAMPLE_RATE/1000.0 + 0.5);
+  int64_t s = atomic_load(&m->replaySample);
+  while ((s < 0 || sample < s) && !atomic_compare_exchange_weak(&m->replaySample, &s, sample));
+}
+
+// Called by every voice and the mixer, on the audio and voice threads. A
+// message to harpy itself is only recorded, and handled at the end of the
+// block. Other messages are only copied into the event bus, which is drained
+// by the bus thread. Nothing is copied unless somebody is listening.
 static void hv_sendHook(double timestamp, const char *receiverName,
     const HvMessage *m, void *userData) {
-  Modules *const mods = (Modules *) userData;
-
-  // respond to an indication that the clip is over and should be restarted
+  SendSource *const source = (SendSource *) userData;
+  EventBus *const bus = &source->modules->bus;
   if (!strcmp(receiverName, "harpy")) {
-    char *buffer = NULL;
-    uint32_t len = 0;
-    oscbuffer_resetIterator(&mods->oscBuffer);
-    while ((buffer = oscbuffer_getNextBuffer(&mods->oscBuffer, &len)) != NULL) {
-      handleOscBuffer(buffer, len, mods);
+    requestReplay(source->modules, timestamp);
+    return;
+  }
+  if (!eventbus_hasSubscribers(bus)) return;
+
+  BusEvent e;
+  e.block = (uint32_t) (timestamp*SAMPLE_RATE/(1000.0*BLOCK_SIZE));
+  e.slot = source->slot;
+  e.voice = source->voice;
+  strncpy(e.receiverName, receiverName, EVENTBUS_NAME_LENGTH-1);
+  e.receiverName[EVENTBUS_NAME_LENGTH-1] = '\0';
+  const int numElements = hv_msg_getNumElements(m);
+  int n = 0;
+  for (int i = 0; i < numElements && n < EVENTBUS_MAX_ELEMENTS; ++i, ++n) {
+    if (hv_msg_isFloat(m, i)) {
+      e.format[n] = 'f';
+      e.elements[n].f = hv_msg_getFloat(m, i);
+    } else if (hv_msg_isSymbol(m, i)) {
+      e.format[n] = 's';
+      strncpy(e.elements[n].s, hv_msg_getSymbol(m, i), EVENTBUS_SYMBOL_LENGTH-1);
+      e.elements[n].s[EVENTBUS_SYMBOL_LENGTH-1] = '\0';
+    } else {
+      e.format[n] = 'I'; // a bang
     }
   }
+  e.format[n] = '\0';
+  eventbus_push(bus, &e);
 }
 
 static void printIpForInterface(const char *ifName) {
@@ -82,7 +197,7 @@ static void printIpForInterface(const char *ifName) {
       if (ifa->ifa_addr->sa_family == AF_INET) {
         struct sockaddr_in *sa = (struct sockaddr_in *) ifa->ifa_addr;
         inet_ntop(AF_INET, &(sa->sin_addr), host, INET_ADDRSTRLEN);
-        printf("harpy is listening on osc.udp://%s:9000\n", host);
+        printf("harpy is listening on osc.udp://%s:%i\n", host, OSC_UDP_PORT);
         break;
       }
     }
@@ -90,176 +205,591 @@ static void printIpForInterface(const char *ifName) {
   freeifaddrs(ifaddr);
 }
 
-/*
- * Allowable OSC message formats:
- * /mixer s:param_name f:param_value
- * /slot f:index s:param_name f:param_value
- * /slot f:index m:midi
- */
-static void handleOscMessage(tosc_message *osc, const uint64_t timetag, Modules *m) {
-  void *context = NULL;
-  if (!strcmp(tosc_getAddress(osc), "/slot")) context = m->mods[(int) tosc_getNextFloat(osc)];
-  else if (!strcmp(tosc_getAddress(osc), "/mixer")) context = m->mixer;
-  else {
-    printf("Unknown OSC address: "); tosc_printMessage(osc);
-    return;
+static void sendFloat(Modules *m, VoicePool *pool, double delayMs,
+    const char *receiverName, float x) {
+  if (pool != NULL) voicepool_scheduleFloatForReceiver(pool, delayMs, receiverName, x);
+  else hv_vscheduleMessageForReceiver(m->mixer, receiverName, delayMs, "f", x);
+}
+
+static void onCoalescedFloat(int slot, const char *receiverName, float x, void *userData) {
+  Modules *const m = (Modules *) userData;
+  sendFloat(m, (slot >= 0) ? m->slots+slot : NULL, 0.0, receiverName, x);
+}
+
+// Sends a float to every voice of a slot, or to the mixer. A float due within
+// the coalescing window waits until the window closes, and is replaced by any
+// newer value for the same receiver. Fader sweeps then cost at most one
+// message per control and window, however fast they arrive.
+static void scheduleFloat(Modules *m, VoicePool *pool, double delayMs,
+    const char *receiverName, float x) {
+  if (m->coalesceBlocks > 0 && delayMs < 1000.0*m->coalesceBlocks*BLOCK_SIZE/SAMPLE_RATE) {
+    const int slot = (pool != NULL) ? (int) (pool - m->slots) : -1;
+    if (coalescer_add(&m->coalescer, slot, receiverName, x)) return;
   }
+  sendFloat(m, pool, delayMs, receiverName, x);
+}
 
-  // calculate delay in seconds, according to timetag format
-  double delay = 0.0;
-  if (timetag != TINYOSC_TIMETAG_IMMEDIATELY) {
-    delay = (double) (timetag >> 32); // seconds
-    delay += ((timetag & 0xFFFFFFFFL) / 4294967296.0); // fractions of second
-  }
-
-  if (!strcmp(tosc_getFormat(osc), "fsf") || !strcmp(tosc_getFormat(osc), "sf")) {
-    hv_sendFloatToReceiver(context,
-        tosc_getNextString(osc), tosc_getNextFloat(osc));
-  } else if (!strcmp(tosc_getFormat(osc), "fm")) {
-    // http://en.flossmanuals.net/pure-data/midi/using-midi/
-    const unsigned char *midi = tosc_getNextMidi(osc);
-    const unsigned char command = midi[0] & 0xF0;
-    const unsigned char channel = midi[0] & 0x0F;
-    const unsigned char data0   = midi[1] & 0x7F;
-    const unsigned char data1   = midi[2] & 0x7F;
-    switch (command) {
-      case 0x80:
-      case 0x90: {
-        hv_vscheduleMessageForReceiver(context,
-            "__hv_notein", delay*1000.0, "fffff",
-            (float) data1,   // data[1]; velocity
-            (float) data0,   // data[0]; pitch
-            (float) channel, // channel
-            (float) command, // command
-            0.0f);           // port
+// sends a note or controller message to a slot, or to the mixer
+static void scheduleMidi(Modules *m, VoicePool *pool, double delayMs,
+    const unsigned char *midi) {
+  // waiting floats are sent first, so that a note still follows the parameters
+  // which were set before it
+  coalescer_flush(&m->coalescer, &onCoalescedFloat, m);
+
+  // http://en.flossmanuals.net/pure-data/midi/using-midi/
+  const unsigned char command = midi[0] & 0xF0;
+  const unsigned char channel = midi[0] & 0x0F;
+  const unsigned char data0   = midi[1] & 0x7F;
+  const unsigned char data1   = midi[2] & 0x7F;
+  switch (command) {
+    case 0x80:
+    case 0x90: {
+      if (pool != NULL) {
+        voicepool_scheduleNote(pool, delayMs, data0, data1, channel, command);
         break;
       }
-      case 0xB0: {
-        hv_vscheduleMessageForReceiver(context,
-            "__hv_ctlin", delay*1000.0, "fffff",
+      hv_vscheduleMessageForReceiver(m->mixer,
+          "__hv_notein", delayMs, "fffff",
+          (float) data1,   // data[1]; velocity
+          (float) data0,   // data[0]; pitch
+          (float) channel, // channel
+          (float) command, // command
+          0.0f);           // port
+      break;
+    }
+    case 0xB0: {
+      // controllers go to every voice of a slot
+      const int numContexts = (pool != NULL) ? pool->numVoices : 1;
+      for (int i = 0; i < numContexts; ++i) {
+        hv_vscheduleMessageForReceiver(
+            (pool != NULL) ? pool->voices[i].context : m->mixer,
+            "__hv_ctlin", delayMs, "fffff",
             (float) data1,   // data[1]; value
             (float) data0,   // data[0]; controller number
             (float) channel,
             (float) command,
             0.0f);           // port
-        break;
       }
-      default: break;
+      break;
     }
+    default: break;
+  }
+}
+
+/*
+ * Allowable OSC message formats:
+ * /mixer s:param_name f:param_value
+ * /slot f:index s:param_name f:param_value
+ * /slot f:index m:midi
+ */
+static void handleOscMessage(const tosc_decoded *osc, const uint64_t timetag,
+    int64_t lateSamples, Modules *m) {
+  VoicePool *pool = NULL;
+  const char *format = osc->format;
+  const tosc_arg *args = osc->args;
+  if (!strcmp(osc->address, "/slot")) {
+    if (format[0] != 'f') return;
+    const int i = (int) args[0].f;
+    if (i < 0 || i >= NUM_SLOTS) return;
+    pool = m->slots+i;
+    ++format; ++args; // the remaining arguments are the same as for the mixer
+  } else if (strcmp(osc->address, "/mixer")) {
+    printf("Unknown OSC address: %s\n", osc->address);
+    return;
+  }
+
+  // calculate delay in seconds, according to timetag format (seconds in the
+  // upper 32 bits, fractions of a second in the lower). The delay is rounded
+  // to the nearest sample, and placed in the middle of it so that heavy
+  // schedules the message exactly there. Messages which are already late
+  // are scheduled that much earlier, and those which are due are immediate.
+  double delay = 0.0;
+  if (timetag != TINYOSC_TIMETAG_IMMEDIATELY) {
+    const int64_t samples = (int64_t) ((timetag >> 32)*SAMPLE_RATE +
+        (((timetag & 0xFFFFFFFFULL)*SAMPLE_RATE + 0x80000000ULL) >> 32)) - lateSamples;
+    if (samples >= 0) delay = (samples + 0.5) / SAMPLE_RATE;
+  }
+
+  if (!strcmp(format, "sf")) {
+    scheduleFloat(m, pool, delay*1000.0, args[0].s, args[1].f);
+  } else if (!strcmp(format, "m")) {
+    scheduleMidi(m, pool, delay*1000.0, args[0].m);
   } else {
-    printf("Unknown OSC format: "); tosc_printMessage(osc);
+    printf("Unknown OSC format: %s %s\n", osc->address, osc->format);
   }
 }
 
-static void handleOscBuffer(char *buffer, int len, Modules *m) {
-  if (tosc_isBundle(buffer)) {
+// Decodes a message, or recursively the elements of a bundle, into p. Each
+// message gets the timetag of its innermost bundle. A nested bundle cannot
+// be scheduled before the bundle enclosing it, or be immediate within it.
+static bool decodeOscPacket(OscPacket *p, char *buffer, int len,
+    uint64_t timetag, int depth) {
+  if (len >= 16 && tosc_isBundle(buffer)) {
+    if (depth == MAX_BUNDLE_DEPTH) return false;
     tosc_bundle bundle;
-    tosc_message osc;
     tosc_parseBundle(&bundle, buffer, len);
-    const uint64_t timetag = tosc_getTimetag(&bundle);
-    // all bundle message are executed simultaneously in heavy
-    pthread_mutex_lock(&m->lock);
-    while (tosc_getNextMessage(&bundle, &osc)) {
-      handleOscMessage(&osc, timetag, m);
+    uint64_t t = tosc_getTimetag(&bundle);
+    if (t == TINYOSC_TIMETAG_IMMEDIATELY || t < timetag) t = timetag;
+    char *element = NULL;
+    uint32_t elementLen = 0;
+    while (tosc_getNextElement(&bundle, &element, &elementLen)) {
+      if (!decodeOscPacket(p, element, (int) elementLen, t, depth+1)) return false;
     }
-    pthread_mutex_unlock(&m->lock);
+    return (bundle.marker == buffer + len); // false if an element is malformed
   } else {
-    tosc_message osc;
-    tosc_parseMessage(&osc, buffer, len);
-    pthread_mutex_lock(&m->lock);
-    handleOscMessage(&osc, TINYOSC_TIMETAG_IMMEDIATELY, m);
-    pthread_mutex_unlock(&m->lock);
+    if (p->numMessages == MAX_BUNDLE_MESSAGES) return false;
+    if (tosc_decodeMessage(p->messages+p->numMessages, buffer, len) != 0) return false;
+    p->timetags[p->numMessages++] = timetag;
+    return true;
   }
 }
 
+/*
+ * Subscriptions to the messages sent by the patches:
+ * /subscribe s:host i:port [s:receiver name, a prefix ending in '*', or "*" (default)]
+ * /unsubscribe s:host i:port
+ * Returns false if the message is not a subscription.
+ */
+static bool handleSubscription(const tosc_decoded *osc, Modules *m) {
+  const tosc_arg *args = osc->args;
+  if (!strcmp(osc->address, "/subscribe")) {
+    if (!strcmp(osc->format, "si") || !strcmp(osc->format, "sis")) {
+      const char *filter = (osc->numArgs == 3) ? args[2].s : "*";
+      if (!eventbus_subscribe(&m->bus, args[0].s, args[1].i, filter)) {
+        printf("Could not subscribe %s:%i\n", args[0].s, args[1].i);
+      }
+    }
+    return true;
+  } else if (!strcmp(osc->address, "/unsubscribe")) {
+    if (!strcmp(osc->format, "si")) eventbus_unsubscribe(&m->bus, args[0].s, args[1].i);
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Loads the contents of a table from a file of 32-bit floats:
+ * /table s:table_name s:path (the mixer)
+ * /table f:index s:table_name s:path (every voice of a slot)
+ * The file must hold as many values as the table. It is read and published
+ * on the network thread, and swapped in by each context at the start of its
+ * next block, so the audio lock is not taken.
+ */
+static void handleTableLoad(const tosc_decoded *osc, Modules *m) {
+  const tosc_arg *args = osc->args;
+  const char *format = osc->format;
+  VoicePool *pool = NULL;
+  if (format[0] == 'f') {
+    const int i = (int) args[0].f;
+    if (i < 0 || i >= NUM_SLOTS) return;
+    pool = m->slots+i;
+    ++format; ++args;
+  }
+  if (strcmp(format, "ss")) return;
+
+  FILE *pFile = fopen(args[1].s, "rb");
+  if (pFile == NULL) {
+    printf("Could not read table file %s\n", args[1].s);
+    return;
+  }
+  fseek(pFile, 0, SEEK_END);
+  const long numBytes = ftell(pFile);
+  fseek(pFile, 0, SEEK_SET);
+  const unsigned int length = (numBytes > 0) ? (unsigned int) (numBytes/sizeof(float)) : 0;
+  float *data = (float *) malloc((length > 0 ? length : 1)*sizeof(float));
+  const bool isRead = (fread(data, sizeof(float), length, pFile) == length);
+  fclose(pFile);
+  if (!isRead) {
+    printf("Could not read table file %s\n", args[1].s);
+    free(data);
+    return;
+  }
+
+  // every voice of a slot gets the contents, or none does. A table can only
+  // be replaced by contents of the same length, and contents which are still
+  // waiting to be swapped in are replaced, so once every table has been
+  // checked the contents are published to all of them.
+  const int numContexts = (pool != NULL) ? pool->numVoices : 1;
+  for (int i = 0; i < numContexts; ++i) {
+    Heavy *c = (pool != NULL) ? pool->voices[i].context : m->mixer;
+    HvTable *table = hv_getTableForName(c, args[0].s);
+    if (table == NULL || hv_table_getLength(table) != length) {
+      printf("Could not load table %s, it does not exist or is not %u samples long\n",
+          args[0].s, length);
+      free(data);
+      return;
+    }
+  }
+  for (int i = 0; i < numContexts; ++i) {
+    Heavy *c = (pool != NULL) ? pool->voices[i].context : m->mixer;
+    hv_publishTable(c, args[0].s, data, length);
+  }
+  free(data);
+}
+
+// Schedules the decoded messages of a packet in heavy, with the lock held.
+// Notes are assigned to voices in the order in which they are scheduled, so
+// the messages are handled in time order (stable, keeping the packet order
+// of simultaneous messages).
+static void scheduleOscPacket(OscPacket *p, int64_t lateSamples, Modules *m) {
+  int order[MAX_BUNDLE_MESSAGES];
+  for (int i = 0; i < p->numMessages; ++i) {
+    int j = i;
+    for (; j > 0 && p->timetags[order[j-1]] > p->timetags[i]; --j) order[j] = order[j-1];
+    order[j] = i;
+  }
+  for (int i = 0; i < p->numMessages; ++i) {
+    handleOscMessage(p->messages+order[i], p->timetags[order[i]], lateSamples, m);
+  }
+}
+
+// packets are validated and decoded completely before the lock is taken,
+// malformed packets are dropped
+static void handleOscBuffer(char *buffer, int len, Modules *m) {
+  OscPacket p;
+  p.numMessages = 0;
+  if (!decodeOscPacket(&p, buffer, len, TINYOSC_TIMETAG_IMMEDIATELY, 0)) return;
+
+  // subscriptions don't touch heavy, and may need to look up a host name,
+  // so they are handled without the lock, as are tables
+  int numMessages = 0;
+  for (int i = 0; i < p.numMessages; ++i) {
+    if (handleSubscription(p.messages+i, m)) continue;
+    if (!strcmp(p.messages[i].address, "/table")) {
+      handleTableLoad(p.messages+i, m);
+      continue;
+    }
+    p.messages[numMessages] = p.messages[i];
+    p.timetags[numMessages++] = p.timetags[i];
+  }
+  p.numMessages = numMessages;
+
+  // all messages of a packet are scheduled simultaneously in heavy
+  pthread_mutex_lock(&m->lock);
+  scheduleOscPacket(&p, 0, m);
+  pthread_mutex_unlock(&m->lock);
+}
+
+// Sends all of the oscbuffer messages into the patch, with the lock held, with
+// their timetags counted from startSample on the audio clock. Messages which
+// are not for the patch, such as subscriptions, are ignored.
+static void replayOscBuffer(Modules *m, int64_t startSample) {
+  // the sample numbers of heavy wrap after a day, so subtract them as such
+  const int64_t lateSamples = (uint32_t) (m->numBlocksRendered*BLOCK_SIZE - (uint64_t) startSample);
+  char *buffer = NULL;
+  uint32_t len = 0;
+  OscPacket p;
+  oscbuffer_resetIterator(&m->oscBuffer);
+  while ((buffer = oscbuffer_getNextBuffer(&m->oscBuffer, &len)) != NULL) {
+    p.numMessages = 0;
+    if (!decodeOscPacket(&p, buffer, len, TINYOSC_TIMETAG_IMMEDIATELY, 0)) continue;
+    int numMessages = 0;
+    for (int i = 0; i < p.numMessages; ++i) {
+      if (strcmp(p.messages[i].address, "/slot") && strcmp(p.messages[i].address, "/mixer")) continue;
+      p.messages[numMessages] = p.messages[i];
+      p.timetags[numMessages++] = p.timetags[i];
+    }
+    p.numMessages = numMessages;
+    scheduleOscPacket(&p, lateSamples, m);
+  }
+}
+
+static void onOscPacket(char *buffer, int len, void *userData) {
+  handleOscBuffer(buffer, len, (Modules *) userData);
+}
+
 // the network thread
 static void *network_run(void *x) {
   assert(x != NULL);
   Modules *m = (Modules *) x;
 
-  struct sockaddr_in sin;
-  int len = 0;
-  char buffer[2*1024]; // 2kB receive buffer
-
-  // prepare the receive socket
-  const int fd_receive = socket(AF_INET, SOCK_DGRAM, 0);
-  assert(fd_receive > 0);
-  sin.sin_family = AF_INET;
-  sin.sin_port = htons(9000);
-  sin.sin_addr.s_addr = INADDR_ANY;
-  bind(fd_receive, (struct sockaddr *) &sin, sizeof(struct sockaddr_in));
-  printIpForInterface("eth0");
-
   while (_keepRunning) {
-    // set up structs for select
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    FD_SET(fd_receive, &rfds);
-
-    struct timeval tv;
-    tv.tv_sec = 1; // wait up to 1 second
-    tv.tv_usec = 0;
-
-    // listen to the socket for any responses
-    if (select(fd_receive+1, &rfds, NULL, NULL, &tv) > 0) {
-      size_t sa_len = sizeof(struct sockaddr_in);
-      if ((len = recvfrom(fd_receive, buffer, sizeof(buffer), 0, (struct sockaddr *) &sin, (socklen_t *) &sa_len)) > 0) {
-        handleOscBuffer(buffer, len, m);
+    governor_printLog(&m->governor);
+
+    // wait up to 1 second for packets on any transport
+    osctransport_poll(&m->transport, 1000);
+
+    // free the contents of tables which have been replaced
+    for (int i = 0; i < NUM_SLOTS; ++i) {
+      for (int j = 0; j < m->slots[i].numVoices; ++j) {
+        hv_collectTables(m->slots[i].voices[j].context);
       }
     }
+    hv_collectTables(m->mixer);
   }
 
-  // close the OSC socket
-  close(fd_receive);
+  return NULL;
+}
+
+// events come from another process, so check them as carefully as OSC
+static void handleControlEvent(ControlEvent *e, Modules *m) {
+  if (e->slot < -1 || e->slot >= NUM_SLOTS) return;
+  VoicePool *pool = (e->slot >= 0) ? m->slots+e->slot : NULL;
+  const double delayMs = (e->delayMs > 0.0) ? e->delayMs : 0.0; // also catches NaN
+  switch (e->type) {
+    case CONTROL_EVENT_FLOAT: {
+      e->receiverName[CONTROLRING_RECEIVER_LENGTH-1] = '\0';
+      scheduleFloat(m, pool, delayMs, e->receiverName, e->value);
+      break;
+    }
+    case CONTROL_EVENT_MIDI: scheduleMidi(m, pool, delayMs, e->midi); break;
+    default: break;
+  }
+}
+
+// the control thread, which passes events from the shared memory ring to heavy
+static void *control_run(void *x) {
+  assert(x != NULL);
+  Modules *m = (Modules *) x;
+
+  ControlEvent e;
+  while (_keepRunning) {
+    controlring_wait(&m->control, 1000);
+    if (!controlring_pop(&m->control, &e)) continue;
+
+    // handle the events which have arrived together under one lock, but
+    // don't hold it for too long
+    pthread_mutex_lock(&m->lock);
+    int n = 0;
+    do {
+      handleControlEvent(&e, m);
+    } while (++n < MAX_CONTROL_EVENTS_PER_LOCK && controlring_pop(&m->control, &e));
+    pthread_mutex_unlock(&m->lock);
+  }
+
+  return NULL;
+}
+
+// the bus thread, which sends the messages of the patches to subscribers
+static void *bus_run(void *x) {
+  assert(x != NULL);
+  Modules *m = (Modules *) x;
+
+  // wake once per block, rather than being woken by the audio thread
+  const struct timespec period = {0, (long) (1000000000.0*BLOCK_SIZE/SAMPLE_RATE)};
+  while (_keepRunning) {
+    clock_nanosleep(CLOCK_MONOTONIC, 0, &period, NULL);
+    eventbus_flush(&m->bus, NULL, NULL);
+  }
+
+  return NULL;
+}
+
+// renders one block of all slots through the mixer
+static int64_t elapsedNs(struct timespec *end, struct timespec *start) {
+  struct timespec diff;
+  timespec_subtract(&diff, end, start);
+  return (((int64_t) diff.tv_sec) * 1000000000L) + diff.tv_nsec;
+}
+
+static void renderBlock(Modules *m, float **outputBuffers) {
+  struct timespec tick, tock, tack;
+  double slotNs[NUM_SLOTS];
+  clock_gettime(CLOCK_MONOTONIC, &tick);
+  pthread_mutex_lock(&m->lock);
+  m->blockStart = tick;
+  if (m->coalesceBlocks > 0 && --m->blocksToFlush <= 0) {
+    coalescer_flush(&m->coalescer, &onCoalescedFloat, m);
+    m->blocksToFlush = m->coalesceBlocks;
+  }
+  tack = tick;
+  for (int i = 0; i < NUM_SLOTS; ++i) {
+    voicepool_process(m->slots+i, m->slotBuffers+(i*NUM_OUTPUT_CHANNELS));
+    clock_gettime(CLOCK_MONOTONIC, &tock);
+    slotNs[i] = (double) elapsedNs(&tock, &tack);
+    tack = tock;
+  }
+  hv_mixer_process(m->mixer, m->slotBuffers, outputBuffers, BLOCK_SIZE);
+  ++m->numBlocksRendered;
+  clock_gettime(CLOCK_MONOTONIC, &tock);
+  const int64_t elapsed_ns = elapsedNs(&tock, &tick);
+  governor_update(&m->governor, slotNs, (double) elapsed_ns);
+
+  // restart the clip if a patch asked for it in this block, from the sample
+  // at which it did, so that the loop keeps time with the audio clock
+  const int64_t replaySample = atomic_exchange(&m->replaySample, -1);
+  if (replaySample >= 0) replayOscBuffer(m, replaySample);
+  pthread_mutex_unlock(&m->lock);
+#if PRINT_PERF
+  printf("%llins (%0.3f%%CPU) %i blocks queued\n",
+      elapsed_ns,
+      100.0*elapsed_ns/(1000000000.0*BLOCK_SIZE/SAMPLE_RATE),
+      audioring_getNumFilled(&m->ring));
+#endif // PRINT_PERF
+}
+
+// the dsp thread, which renders blocks ahead of the device into the ring
+static void *dsp_run(void *x) {
+  assert(x != NULL);
+  Modules *m = (Modules *) x;
+  float *outputBuffers[NUM_OUTPUT_CHANNELS];
+
+  while (true) {
+    audioring_beginWrite(&m->ring, outputBuffers);
+    if (!_keepRunning) break;
+    renderBlock(m, outputBuffers);
+    audioring_endWrite(&m->ring);
+  }
 
   return NULL;
 }
 
-// http://www.alsa-project.org/alsa-doc/alsa-lib/_2test_2pcm_min_8c-example.html
+// Returns the delay which gives MIDI read at time t a constant latency against
+// the audio clock. An event which arrives some time after the last block
+// started rendering is scheduled the same time into the next block, rather
+// than at its start.
+static double getMidiDelayMs(Modules *m, struct timespec *t) {
+  const double blockMs = 1000.0*BLOCK_SIZE/SAMPLE_RATE;
+  const double delayMs = elapsedNs(t, &m->blockStart) / 1000000.0;
+  // the audio has stopped or has not started yet
+  return (delayMs >= 0.0 && delayMs < blockMs) ? delayMs : 0.0;
+}
+
+// the MIDI thread, which passes the events of a MIDI device to heavy
+static void *midi_run(void *x) {
+  assert(x != NULL);
+  Modules *m = (Modules *) x;
+
+  uint8_t messages[MIDIINPUT_MAX_MESSAGES][3];
+  struct timespec t;
+  while (_keepRunning) {
+    const int n = midiinput_read(&m->midi, 1000, messages, &t);
+    if (n < 0) {
+      printf("The MIDI device has gone away\n");
+      break;
+    }
+
+    // MIDI channels 1 to NUM_SLOTS play the slots, the others go to the mixer
+    pthread_mutex_lock(&m->lock);
+    const double delayMs = getMidiDelayMs(m, &t);
+    for (int i = 0; i < n; ++i) {
+      const int channel = messages[i][0] & 0x0F;
+      scheduleMidi(m, (channel < NUM_SLOTS) ? m->slots+channel : NULL, delayMs, messages[i]);
+    }
+    pthread_mutex_unlock(&m->lock);
+  }
+
+  return NULL;
+}
+
+static void printUsage() {
+  printf("Usage: harpy [-o audio backend] [-d ring depth in blocks] [-p number of periods] [-t seconds]\n");
+  printf("             [-c OSC TCP port] [-u OSC unix socket path] [-s control ring name]\n");
+  printf("             [-w coalescing window in blocks] [-m MIDI device]\n");
+  printf("Audio backends:\n");
+  printf("  alsa[:device]       ALSA, read/write access (default %s)\n", DEFAULT_AUDIO_BACKEND);
+  printf("  alsa-mmap[:device]  ALSA, mmap access\n");
+  printf("  null                discard the output, in real time\n");
+  printf("  wav[:filename]      write the output to a file, as fast as possible\n");
+  printf("The ring holds %i blocks by default, one of which is being written to the device\n", DEFAULT_RING_DEPTH);
+  printf("while the others are rendered ahead. A depth of 0 renders in the device thread.\n");
+  printf("OSC is received on UDP port %i, on TCP port %i with length or SLIP framing\n", OSC_UDP_PORT, DEFAULT_OSC_TCP_PORT);
+  printf("and on the unix datagram socket %s. A port of 0 or an empty path disables it.\n", DEFAULT_OSC_UNIX_SOCKET);
+  printf("Local processes may also send events through the shared memory ring %s\n", DEFAULT_CONTROL_RING);
+  printf("with harpyclient.h. An empty name disables it.\n");
+  printf("Within the coalescing window (default %i), only the newest value of each\n", DEFAULT_COALESCE_BLOCKS);
+  printf("control is sent to the patches. A window of 0 sends every value.\n");
+  printf("MIDI may be read from an ALSA rawmidi device (e.g. hw:1,0,0, see $ amidi -l).\n");
+  printf("Channels 1 to %i play the slots, the others go to the mixer.\n", NUM_SLOTS);
+}
+
 // sudo amixer cset numid=3 1
-int main() {
+int main(int argc, char **argv) {
+  const char *backendSpec = DEFAULT_AUDIO_BACKEND;
+  int ringDepth = DEFAULT_RING_DEPTH;
+  int numPeriods = DEFAULT_NUM_PERIODS;
+  double duration = 0.0; // seconds of audio to render, 0 until interrupted
+  int coalesceBlocks = DEFAULT_COALESCE_BLOCKS;
+  int tcpPort = DEFAULT_OSC_TCP_PORT;
+  const char *unixPath = DEFAULT_OSC_UNIX_SOCKET;
+  const char *controlName = DEFAULT_CONTROL_RING;
+  const char *midiDevice = NULL;
+  for (int c; (c = getopt(argc, argv, "o:d:p:t:c:u:s:w:m:")) != -1;) {
+    switch (c) {
+      case 'o': backendSpec = optarg; break;
+      case 'c': tcpPort = atoi(optarg); break;
+      case 'u': unixPath = optarg; break;
+      case 's': controlName = optarg; break;
+      case 'd': ringDepth = atoi(optarg); break;
+      case 'p': numPeriods = atoi(optarg); break;
+      case 't': duration = atof(optarg); break;
+      case 'w': coalesceBlocks = atoi(optarg); break;
+      case 'm': midiDevice = optarg; break;
+      default: printUsage(); return 0;
+    }
+  }
+  if (ringDepth < 0 || numPeriods < 1 || coalesceBlocks < 0) {
+    printUsage();
+    return 0;
+  }
+
   signal(SIGINT, &sigintHandler); // register the SIGINT handler
 
   // create the modules (and initialise the lock)
   Modules m;
   pthread_mutex_init(&m.lock, NULL);
-
-  struct timespec tick, tock;
+  coalescer_init(&m.coalescer);
+  m.coalesceBlocks = coalesceBlocks;
+  m.blocksToFlush = coalesceBlocks;
+  memset(&m.blockStart, 0, sizeof(m.blockStart));
+
+  // open the OSC sockets
+  if (!osctransport_init(&m.transport, OSC_UDP_PORT, tcpPort, unixPath, &onOscPacket, &m)) {
+    osctransport_free(&m.transport);
+    return -1;
+  }
+  printIpForInterface("eth0");
+  if (tcpPort > 0) printf("harpy is listening on osc.tcp://*:%i\n", tcpPort);
 
   // setup sound output
-  // list all devices: $ aplay -L
-  snd_pcm_t *alsa = NULL;
-  snd_pcm_open(&alsa, ALSA_DEVICE, SND_PCM_STREAM_PLAYBACK, 0);
-  snd_pcm_set_params(alsa,
-      SND_PCM_FORMAT_FLOAT_LE,
-      SND_PCM_ACCESS_RW_NONINTERLEAVED,
-      NUM_OUTPUT_CHANNELS, // stereo output
-      SAMPLE_RATE, // 48KHz sampling rate
-      0,           // 0 = disallow alsa-lib resample stream, 1 = allow resampling
-      (unsigned int) (1000000.0*BLOCK_SIZE/SAMPLE_RATE)); // required overall latency in us
+  AudioBackend *backend = audiobackend_new(backendSpec,
+      NUM_OUTPUT_CHANNELS, SAMPLE_RATE, BLOCK_SIZE, numPeriods);
+  if (backend == NULL) {
+    osctransport_free(&m.transport);
+    return -1;
+  }
 
   {
-    snd_pcm_uframes_t buffer_size = 0;
-    snd_pcm_uframes_t period_size = 0;
-    snd_pcm_get_params(alsa, &buffer_size, &period_size);
-    printf("ALSA:\n  * buffer size: %lu\n  * period size: %lu\n",
-        buffer_size, period_size);
+    // report the output latency, including the blocks rendered ahead in the
+    // ring. The block being written to the device is not ahead.
+    const int bufferFrames = audiobackend_getLatency(backend);
+    const int lookahead = (ringDepth > 1) ? ringDepth-1 : 0;
+    const int ringFrames = lookahead*BLOCK_SIZE;
+    printf("Latency:\n  * %s buffer: %0.3fms\n  * ring (%i blocks ahead): %0.3fms\n  * total: %0.3fms\n",
+        backend->name, 1000.0*bufferFrames/SAMPLE_RATE,
+        lookahead, 1000.0*ringFrames/SAMPLE_RATE,
+        1000.0*(bufferFrames+ringFrames)/SAMPLE_RATE);
   }
 
   // initialise all heavy slots
-  m.mixer = hv_mixer_new(SAMPLE_RATE);
-
-  m.mods[0] = hv_slot0_new(SAMPLE_RATE);
-  assert(hv_getNumOutputChannels(m.mods[0]) == NUM_OUTPUT_CHANNELS);
-  hv_setPrintHook(m.mods[0], &hv_printHook);
-  hv_setSendHook(m.mods[0], &hv_sendHook);
-  hv_setUserData(m.mods[0], &m);
+  // the messages sent by the patches go out through the event bus
+  eventbus_init(&m.bus, EVENT_BUS_CAPACITY);
+  atomic_init(&m.replaySample, -1);
+  m.numBlocksRendered = 0;
 
-  m.mods[1] = hv_slot1_new(SAMPLE_RATE);
-  assert(hv_getNumOutputChannels(m.mods[1]) == NUM_OUTPUT_CHANNELS);
-  hv_setPrintHook(m.mods[1], &hv_printHook);
-  hv_setSendHook(m.mods[1], &hv_sendHook);
-  hv_setUserData(m.mods[1], &m);
+  m.mixer = hv_mixer_new(SAMPLE_RATE);
+  m.sources[0] = (SendSource) {&m, -1, 0};
+  hv_setSendHook(m.mixer, &hv_sendHook);
+  hv_setUserData(m.mixer, m.sources);
+
+  // each slot is a pool of voices, processed on all cores
+  const int numThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  for (int i = 0; i < NUM_SLOTS; ++i) {
+    voicepool_init(m.slots+i, SLOT_FUNCTIONS+i,
+        NUM_VOICES_PER_SLOT, numThreads, SAMPLE_RATE, BLOCK_SIZE);
+    for (int j = 0; j < m.slots[i].numVoices; ++j) {
+      Heavy *context = m.slots[i].voices[j].context;
+      assert(hv_getNumOutputChannels(context) == NUM_OUTPUT_CHANNELS);
+      hv_setPrintHook(context, &hv_printHook);
+      SendSource *source = m.sources + 1 + i*NUM_VOICES_PER_SLOT + j;
+      *source = (SendSource) {&m, (int8_t) i, (int8_t) j};
+      hv_setSendHook(context, &hv_sendHook);
+      hv_setUserData(context, source);
+    }
+  }
+  printf("%i slots of %i voices on %i threads\n",
+      NUM_SLOTS, NUM_VOICES_PER_SLOT, numThreads);
+  governor_init(&m.governor, m.slots, NUM_SLOTS, 1000000000.0*BLOCK_SIZE/SAMPLE_RATE);
 
   // read osc buffers from file
   {
@@ -280,7 +810,9 @@ int main() {
     }
 
     // dump all of the oscbuffer messages into the patch
-    hv_sendHook(0.0, "harpy", NULL, &m);
+    pthread_mutex_lock(&m.lock);
+    replayOscBuffer(&m, 0);
+    pthread_mutex_unlock(&m.lock);
   }
 
   // create and start the network thread
@@ -288,56 +820,110 @@ int main() {
   pthread_t networkThread = 0;
   pthread_create(&networkThread, NULL, &network_run, &m);
 
+  // start the bus thread
+  pthread_t busThread = 0;
+  pthread_create(&busThread, NULL, &bus_run, &m);
+
+  // create the control ring, and start the thread which reads it
+  pthread_t controlThread = 0;
+  m.hasControl = (controlName[0] != '\0');
+  if (m.hasControl) {
+    m.hasControl = controlring_create(&m.control, controlName, CONTROL_RING_CAPACITY);
+    if (m.hasControl) {
+      printf("harpy is listening on shared memory %s\n", controlName);
+      pthread_create(&controlThread, NULL, &control_run, &m);
+    } else {
+      printf("Could not create the control ring %s\n", controlName);
+    }
+  }
+
+  // open the MIDI device, and start the thread which reads it
+  pthread_t midiThread = 0;
+  m.hasMidi = (midiDevice != NULL && midiinput_open(&m.midi, midiDevice));
+  if (m.hasMidi) {
+    printf("harpy is listening on MIDI device %s\n", midiDevice);
+    pthread_create(&midiThread, NULL, &midi_run, &m);
+  }
+
   // the audio loop
-  float *audioBuffer[4] = {
-    (float *) alloca(BLOCK_SIZE*sizeof(float)),
-    (float *) alloca(BLOCK_SIZE*sizeof(float)),
-    (float *) alloca(BLOCK_SIZE*sizeof(float)),
-    (float *) alloca(BLOCK_SIZE*sizeof(float))
-  };
-  float *audioBufferMixed[2] = {
-    (float *) alloca(BLOCK_SIZE*sizeof(float)),
-    (float *) alloca(BLOCK_SIZE*sizeof(float))
-  };
-  while (_keepRunning) {
-    // process Heavy
-    clock_gettime(CLOCK_REALTIME, &tick);
-    pthread_mutex_lock(&m.lock);
-    hv_slot0_process(m.mods[0], NULL, audioBuffer, BLOCK_SIZE);
-    hv_slot1_process(m.mods[1], NULL, audioBuffer+2, BLOCK_SIZE);
-    pthread_mutex_unlock(&m.lock);
-    hv_mixer_process(m.mixer, audioBuffer, audioBufferMixed, BLOCK_SIZE);
-    clock_gettime(CLOCK_REALTIME, &tock);
-#if PRINT_PERF
-    struct timespec diff_tock;
-    timespec_subtract(&diff_tock, &tock, &tick);
-    const int64_t elapsed_ns = (((int64_t) diff_tock.tv_sec) * 1000000000L) + diff_tock.tv_nsec;
-    printf("%llins (%0.3f%%CPU)\n",
-        elapsed_ns,
-        100.0*elapsed_ns/(1000000000.0*BLOCK_SIZE/SAMPLE_RATE));
-#endif // PRINT_PERF
+  for (int i = 0; i < NUM_SLOTS*NUM_OUTPUT_CHANNELS; ++i) {
+    m.slotBuffers[i] = (float *) aligned_alloc(32, BLOCK_SIZE*sizeof(float));
+  }
+  float *audioBufferMixed[NUM_OUTPUT_CHANNELS];
+
+  // in pipelined mode the dsp thread renders the next blocks while this one
+  // drains the current block into the device
+  pthread_t dspThread = 0;
+  if (ringDepth > 0) {
+    audioring_init(&m.ring, ringDepth, NUM_OUTPUT_CHANNELS, BLOCK_SIZE);
+    pthread_create(&dspThread, NULL, &dsp_run, &m);
+  } else {
+    audioring_init(&m.ring, 1, NUM_OUTPUT_CHANNELS, BLOCK_SIZE);
+  }
 
-    snd_pcm_sframes_t frames = snd_pcm_writen(
-        alsa, (void **) audioBufferMixed, BLOCK_SIZE);
-    if (frames < 0) {
-      frames = snd_pcm_recover(alsa, frames, 0);
-      if (frames < 0) printf("ALSA: %s\n", snd_strerror(frames));
+  const uint64_t numBlocks = (uint64_t) (duration*SAMPLE_RATE/BLOCK_SIZE);
+  audiobackend_start(backend);
+  for (uint64_t n = 0; _keepRunning && (numBlocks == 0 || n < numBlocks); ++n) {
+    if (ringDepth > 0) {
+      audioring_beginRead(&m.ring, audioBufferMixed);
+      if (!_keepRunning) break;
+    } else {
+      audioring_beginWrite(&m.ring, audioBufferMixed);
+      renderBlock(&m, audioBufferMixed);
+      audioring_endWrite(&m.ring);
+      audioring_beginRead(&m.ring, audioBufferMixed);
     }
+
+    audiobackend_write(backend, audioBufferMixed, BLOCK_SIZE);
+
+    audioring_endRead(&m.ring);
+  }
+  _keepRunning = false;
+
+  // wait until the dsp thread has quit
+  if (ringDepth > 0) {
+    audioring_wake(&m.ring);
+    pthread_join(dspThread, NULL);
+  }
+  audioring_free(&m.ring);
+  for (int i = 0; i < NUM_SLOTS*NUM_OUTPUT_CHANNELS; ++i) {
+    free(m.slotBuffers[i]);
   }
 
-  // wait until the network thread has quit
+  // wait until the network thread has quit, and close the OSC sockets
   pthread_join(networkThread, NULL);
+  osctransport_free(&m.transport);
+
+  // wait until the bus thread has quit
+  pthread_join(busThread, NULL);
+
+  // wait until the control thread has quit, and remove the ring
+  if (m.hasControl) {
+    controlring_wake(&m.control);
+    pthread_join(controlThread, NULL);
+    controlring_close(&m.control);
+  }
+
+  // wait until the MIDI thread has quit, and close the device
+  if (m.hasMidi) {
+    pthread_join(midiThread, NULL);
+    midiinput_close(&m.midi);
+  }
 
   // destroy the lock
   pthread_mutex_destroy(&m.lock);
 
   // shut down the audio
-  snd_pcm_close(alsa);
+  printf("%u xruns\n", backend->numXruns);
+  printf("%u control values coalesced\n", m.coalescer.numCoalesced);
+  audiobackend_free(backend);
 
   // free heavy slots
-  hv_slot0_free(m.mods[0]);
-  hv_slot1_free(m.mods[1]);
+  for (int i = 0; i < NUM_SLOTS; ++i) {
+    voicepool_free(m.slots+i);
+  }
   hv_mixer_free(m.mixer);
+  eventbus_free(&m.bus);
 
   // free oscbuffer
   oscbuffer_free(&m.oscBuffer);
@@ -2,6 +2,8 @@
 
 // $ clang midi2osc.c ./tinyosc/tinyosc.c -I/usr/local/include -L/usr/local/lib -lusb-1.0 -o midi2osc
 // $ sudo ./midi2osc 192.168.0.33 9000
+// $ sudo ./midi2osc /tmp/harpy.osc # harpy on the same machine
+// $ sudo ./midi2osc -f nanokontrol2.conf /tmp/harpy.osc
 
 #include <arpa/inet.h>
 #include <libusb-1.0/libusb.h>
@@ -10,45 +12,382 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/un.h>
+#include <time.h>
 #include <unistd.h> // for close
 
 #include "tinyosc/tinyosc.h" // OSC support
 
-#define KORG_NANOKONTROL2_VENDOR_ID 0x0944
-#define KORG_NANOKONTROL2_PRODUCT_ID 0x0117
-#define KORG_NANOKONTROL2_ENDPOINT 0x81
-
-#define USB_BULK_TRANSFER_TIMEOUT_MS 1000
+#define DEFAULT_CONFIG_FILE "midi2osc.conf"
+#define USB_POLL_TIMEOUT_MS 1000
+#define NUM_TRANSFERS 4 // bulk transfers in flight at once, per device
+#define MAX_BUNDLE_SIZE 1472 // bytes, so that a bundle is not fragmented on ethernet
+#define MAX_DEVICES 8
+#define MAX_TEMPLATES 1024 // distinct OSC addresses, over all devices
+#define MAX_TEMPLATE_SIZE 128 // bytes
+#define DEFAULT_WINDOW_US 5333 // one block of 256 samples at 48kHz
 
 static void printInfoForNonSystemDevice(libusb_device *device);
-static const char *getOscAddressForControl(const unsigned char c);
 
 static volatile bool _keepRunning = true;
 
+// an OSC message with a single float argument, encoded once when the
+// configuration is loaded. The argument is the last 4 bytes.
+typedef struct {
+  char buffer[MAX_TEMPLATE_SIZE];
+  uint32_t len;
+} Template;
+
+struct Pending;
+
+typedef struct {
+  uint16_t vendorId;
+  uint16_t productId;
+  uint8_t endpoint;
+  uint8_t interface;
+  int16_t controls[16][128]; // the template of each channel and controller, or -1
+
+  libusb_device_handle *handle;
+  bool kernelWasActive;
+  struct libusb_transfer *transfers[NUM_TRANSFERS];
+  struct Pending *pending;
+} Device;
+
+typedef struct {
+  Template templates[MAX_TEMPLATES];
+  int numTemplates;
+  Device devices[MAX_DEVICES];
+  int numDevices;
+} Config;
+
+// a control change waiting to be sent
+typedef struct {
+  int16_t templateIndex;
+  float value;
+  struct timespec t; // the completion time of the transfer which carried it
+} ControlChange;
+
+// the newest value of each OSC address which changed in the current window
+typedef struct Pending {
+  const Config *config;
+  ControlChange changes[MAX_TEMPLATES];
+  int numChanges;
+  int16_t index[MAX_TEMPLATES]; // the position of each template in changes, or -1
+  int numInFlight; // transfers which have been submitted and not yet completed
+} Pending;
+
+// returns the template of the address, adding it if it is new
+static int config_getTemplate(Config *c, const char *address) {
+  for (int i = 0; i < c->numTemplates; ++i) {
+    if (!strcmp(c->templates[i].buffer, address)) return i;
+  }
+  if (c->numTemplates == MAX_TEMPLATES) return -1;
+  Template *t = c->templates + c->numTemplates;
+  t->len = tosc_writeMessage(t->buffer, sizeof(t->buffer), address, "f", 0.0f);
+  if (t->len == 0) return -1; // the address is too long
+  return c->numTemplates++;
+}
+
+/*
+ * The configuration lists the devices to open, each followed by its mapping
+ * of controllers to OSC addresses. Numbers are hexadecimal for devices, and
+ * decimal for controllers. A channel of * maps all 16 channels.
+ *
+ * # comment
+ * device <vendor id> <product id> [endpoint, default 81] [interface, default 0]
+ * cc <channel 1-16 or *> <controller 0-127> <OSC address>
+ */
+static bool config_load(Config *c, const char *filename) {
+  c->numTemplates = 0;
+  c->numDevices = 0;
+  FILE *file = fopen(filename, "r");
+  if (file == NULL) {
+    printf("Could not read the configuration %s\n", filename);
+    return false;
+  }
+
+  bool success = true;
+  char line[256];
+  for (int n = 1; success && fgets(line, sizeof(line), file) != NULL; ++n) {
+    char keyword[16] = "";
+    if (sscanf(line, "%15s", keyword) != 1 || keyword[0] == '#') continue;
+    if (!strcmp(keyword, "device")) {
+      unsigned int vendorId = 0, productId = 0, endpoint = 0x81, interface = 0;
+      if (c->numDevices == MAX_DEVICES ||
+          sscanf(line, "device %x %x %x %u", &vendorId, &productId, &endpoint, &interface) < 2) {
+        success = false;
+      } else {
+        Device *d = c->devices + c->numDevices++;
+        memset(d, 0, sizeof(Device));
+        d->vendorId = (uint16_t) vendorId;
+        d->productId = (uint16_t) productId;
+        d->endpoint = (uint8_t) endpoint;
+        d->interface = (uint8_t) interface;
+        memset(d->controls, 0xFF, sizeof(d->controls)); // -1
+      }
+    } else if (!strcmp(keyword, "cc")) {
+      char channel[4] = "";
+      char address[MAX_TEMPLATE_SIZE] = "";
+      int controller = -1;
+      const int k = (c->numDevices > 0 &&
+          sscanf(line, "cc %3s %d %127s", channel, &controller, address) == 3) ?
+          config_getTemplate(c, address) : -1;
+      const int ch = atoi(channel);
+      if (k < 0 || controller < 0 || controller > 127 ||
+          (strcmp(channel, "*") && (ch < 1 || ch > 16))) {
+        success = false;
+      } else {
+        Device *d = c->devices + c->numDevices - 1;
+        for (int i = 0; i < 16; ++i) {
+          if (!strcmp(channel, "*") || i == ch-1) d->controls[i][controller] = (int16_t) k;
+        }
+      }
+    } else {
+      success = false;
+    }
+    if (!success) printf("%s:%i: invalid line: %s", filename, n, line);
+  }
+  fclose(file);
+  if (success && c->numDevices == 0) {
+    printf("%s: no devices\n", filename);
+    success = false;
+  }
+  return success;
+}
+
+static void pending_reset(Pending *p) {
+  for (int i = 0; i < MAX_TEMPLATES; ++i) p->index[i] = -1;
+  p->numChanges = 0;
+}
+
+// Records the control changes of one USB packet. An address which already
+// changed in this window only keeps its newest value.
+static void pending_addPacket(Pending *p, const Device *d, const unsigned char *usb, int len,
+    const struct timespec *t) {
+  // each USB-MIDI event is 4 bytes: cable and code index, status, data1, data2
+  for (int i = 0; i+3 < len; i += 4) {
+    if ((usb[i+1] & 0xF0) != 0xB0) continue; // only control changes are mapped
+    const int k = d->controls[usb[i+1] & 0x0F][usb[i+2] & 0x7F];
+    if (k < 0) continue;
+    if (p->index[k] < 0) {
+      p->index[k] = (int16_t) p->numChanges++;
+      p->changes[p->index[k]].templateIndex = (int16_t) k;
+    }
+    ControlChange *change = p->changes + p->index[k];
+    change->value = (usb[i+3] & 0x7F) / 127.0f;
+    change->t = *t;
+  }
+}
+
+static uint64_t getTimetagForInterval(const struct timespec *end, const struct timespec *start) {
+  const int64_t ns = (end->tv_sec - start->tv_sec)*1000000000LL + (end->tv_nsec - start->tv_nsec);
+  if (ns <= 0) return TINYOSC_TIMETAG_IMMEDIATELY;
+  return (((uint64_t) (ns / 1000000000LL)) << 32) |
+      (uint64_t) (((ns % 1000000000LL) << 32) / 1000000000LL);
+}
+
+// appends a size-prefixed element to a bundle, returns a pointer to its copy
+static char *bundle_append(tosc_bundle *b, const char *element, uint32_t len) {
+  const uint32_t size = htonl(len);
+  char *marker = b->marker;
+  memcpy(marker, &size, 4);
+  memcpy(marker+4, element, len);
+  b->marker += 4 + len;
+  b->bundleLen += 4 + len;
+  return marker+4;
+}
+
+// Sends the pending changes as an OSC bundle. The changes carried by each USB
+// packet are a nested bundle, timed relative to the earliest packet of the
+// window, so that the events keep their spacing and all arrive with the same
+// latency. Each message is a copy of its template with the value patched in.
+static void pending_send(Pending *p, int fd) {
+  if (p->numChanges == 0) return;
+  struct timespec first = p->changes[0].t;
+  for (int i = 1; i < p->numChanges; ++i) {
+    const struct timespec *t = &p->changes[i].t;
+    if (t->tv_sec < first.tv_sec || (t->tv_sec == first.tv_sec && t->tv_nsec < first.tv_nsec)) first = *t;
+  }
+
+  char buffer[MAX_BUNDLE_SIZE];
+  tosc_bundle bundle;
+  tosc_writeBundle(&bundle, TINYOSC_TIMETAG_IMMEDIATELY, buffer, sizeof(buffer));
+  bool isWritten[MAX_TEMPLATES] = {false};
+  for (int i = 0; i < p->numChanges; ++i) {
+    if (isWritten[i]) continue;
+    const struct timespec *t = &p->changes[i].t;
+
+    // start a new datagram if another nested bundle might not fit
+    if (tosc_getBundleLength(&bundle) + 4 + 16 + 4 + MAX_TEMPLATE_SIZE > sizeof(buffer)) {
+      send(fd, buffer, tosc_getBundleLength(&bundle), 0);
+      tosc_writeBundle(&bundle, TINYOSC_TIMETAG_IMMEDIATELY, buffer, sizeof(buffer));
+    }
+
+    char innerBuffer[MAX_BUNDLE_SIZE];
+    tosc_bundle inner;
+    tosc_writeBundle(&inner, getTimetagForInterval(t, &first), innerBuffer,
+        sizeof(buffer) - tosc_getBundleLength(&bundle) - 4);
+    for (int j = i; j < p->numChanges; ++j) {
+      const ControlChange *change = p->changes + j;
+      if (isWritten[j] || change->t.tv_sec != t->tv_sec || change->t.tv_nsec != t->tv_nsec) continue;
+      const Template *tmpl = p->config->templates + change->templateIndex;
+      if (tosc_getBundleLength(&inner) + 4 + tmpl->len > inner.bufLen) break;
+      char *message = bundle_append(&inner, tmpl->buffer, tmpl->len);
+      uint32_t value = 0;
+      memcpy(&value, &change->value, 4);
+      value = htonl(value);
+      memcpy(message + tmpl->len - 4, &value, 4);
+      isWritten[j] = true;
+    }
+
+    // the nested bundle is an element of the outer bundle
+    bundle_append(&bundle, innerBuffer, tosc_getBundleLength(&inner));
+  }
+  send(fd, buffer, tosc_getBundleLength(&bundle), 0);
+  pending_reset(p);
+}
+
+static void transferCallback(struct libusb_transfer *transfer) {
+  Device *d = (Device *) transfer->user_data;
+  Pending *p = d->pending;
+  --p->numInFlight;
+  if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t); // timestamp at completion
+    // printf("[%i] ", transfer->actual_length); for (int j = 0; j < 4; j++) printf("%02X", transfer->buffer[j]); printf("\n");
+    pending_addPacket(p, d, transfer->buffer, transfer->actual_length, &t);
+  } else if (transfer->status == LIBUSB_TRANSFER_CANCELLED) {
+    return;
+  } else {
+    // the device stops, the others carry on
+    printf("Error while waiting for bulk transfer from %04X:%04X: %i\n",
+        d->vendorId, d->productId, transfer->status);
+    return;
+  }
+
+  // submit the transfer again straight away, so that several stay in flight
+  if (_keepRunning && libusb_submit_transfer(transfer) == 0) ++p->numInFlight;
+}
+
+// opens a configured device and starts reading it
+static bool device_open(Device *d, libusb_context *usbctx, Pending *p) {
+  d->pending = p;
+  d->handle = libusb_open_device_with_vid_pid(usbctx, d->vendorId, d->productId);
+  if (d->handle == NULL) {
+    printf("Could not open device with Vendor:Product Id %04X:%04X\n",
+        d->vendorId, d->productId);
+    return false;
+  }
+  int err = 0;
+  d->kernelWasActive = libusb_kernel_driver_active(d->handle, d->interface);
+  if (d->kernelWasActive) err = libusb_detach_kernel_driver(d->handle, d->interface);
+  if (err != 0) {
+    printf("Could not detach kernel: %s\n", libusb_error_name(err));
+    libusb_close(d->handle);
+    d->handle = NULL;
+    return false;
+  }
+  err = libusb_claim_interface(d->handle, d->interface);
+  if (err != 0) {
+    printf("Could not claim interface: %s\n", libusb_error_name(err));
+    if (d->kernelWasActive) libusb_attach_kernel_driver(d->handle, d->interface);
+    libusb_close(d->handle);
+    d->handle = NULL;
+    return false;
+  }
+
+  // keep several transfers in flight, so that no packet waits for
+  // the previous one to be handled
+  const int maxPacketSize = libusb_get_max_packet_size(
+      libusb_get_device(d->handle), d->endpoint);
+  for (int i = 0; i < NUM_TRANSFERS; ++i) {
+    d->transfers[i] = libusb_alloc_transfer(0);
+    libusb_fill_bulk_transfer(d->transfers[i], d->handle, d->endpoint,
+        (unsigned char *) malloc(maxPacketSize), maxPacketSize,
+        &transferCallback, d, 0); // no timeout
+    if (libusb_submit_transfer(d->transfers[i]) == 0) ++p->numInFlight;
+  }
+  return true;
+}
+
+// releases a device once its transfers have been cancelled and have come back
+static void device_close(Device *d) {
+  if (d->handle == NULL) return;
+  for (int i = 0; i < NUM_TRANSFERS; ++i) {
+    free(d->transfers[i]->buffer);
+    libusb_free_transfer(d->transfers[i]);
+  }
+  libusb_release_interface(d->handle, d->interface);
+
+  // reattach the kernel driver if necessary
+  if (d->kernelWasActive) libusb_attach_kernel_driver(d->handle, d->interface);
+  libusb_close(d->handle);
+  d->handle = NULL;
+}
+
 static void sigintHandler(int x) {
   _keepRunning = false; // handle Ctrl+C
 }
 
+static int64_t elapsedUs(const struct timespec *end, const struct timespec *start) {
+  return (end->tv_sec - start->tv_sec)*1000000LL + (end->tv_nsec - start->tv_nsec)/1000;
+}
+
 int main(int argc, char **argv) {
-  if (argc < 3) {
-    printf("Usage: midi2osc <r:IP address> <r:port>\n");
+  // a control which moves faster than the window only sends its newest value,
+  // once per window
+  int windowUs = DEFAULT_WINDOW_US;
+  const char *configFile = DEFAULT_CONFIG_FILE;
+  for (int c; (c = getopt(argc, argv, "w:f:")) != -1;) {
+    switch (c) {
+      case 'w': windowUs = (int) (atof(optarg)*1000.0); break;
+      case 'f': configFile = optarg; break;
+      default: argc = 0; break;
+    }
+  }
+  argc -= optind-1;
+  argv += optind-1;
+  if (windowUs < 0 || (argc < 3 && (argc < 2 || argv[1][0] != '/'))) {
+    printf("Usage: midi2osc [-w window in ms] [-f configuration] <r:IP address> <r:port>\n");
+    printf("       midi2osc [-w window in ms] [-f configuration] <r:unix socket path>\n");
+    printf("The default window is %0.3fms, 0 sends every change.\n", DEFAULT_WINDOW_US/1000.0);
+    printf("The default configuration is %s.\n", DEFAULT_CONFIG_FILE);
     return 0;
   }
 
+  // load the devices and their mappings
+  Config *config = (Config *) malloc(sizeof(Config));
+  if (!config_load(config, configFile)) {
+    free(config);
+    return -1;
+  }
+
   signal(SIGINT, &sigintHandler); // register the SIGINT handler
 
   // initialise the error return value
   int err = 0;
 
   // initialise send socket
-  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
-  struct sockaddr_in sin;
-  sin.sin_family = AF_INET;
-  inet_pton(AF_INET, argv[1], &sin.sin_addr);
-  sin.sin_port = htons(atoi(argv[2]));
-  err = connect(fd, (struct sockaddr *) &sin, sizeof(struct sockaddr_in));
+  int fd = -1;
+  if (argc < 3) {
+    // a unix datagram socket skips the IP stack entirely
+    struct sockaddr_un sun;
+    memset(&sun, 0, sizeof(sun));
+    sun.sun_family = AF_UNIX;
+    strncpy(sun.sun_path, argv[1], sizeof(sun.sun_path)-1);
+    fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    err = connect(fd, (struct sockaddr *) &sun, sizeof(struct sockaddr_un));
+  } else {
+    struct sockaddr_in sin;
+    sin.sin_family = AF_INET;
+    inet_pton(AF_INET, argv[1], &sin.sin_addr);
+    sin.sin_port = htons(atoi(argv[2]));
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    err = connect(fd, (struct sockaddr *) &sin, sizeof(struct sockaddr_in));
+  }
   if (err != 0) {
     printf("Failed to open OSC socket: %i\n", err);
+    free(config);
     return -1;
   }
 
@@ -62,58 +401,55 @@ int main(int argc, char **argv) {
   }
   libusb_free_device_list(device_list, 1);
 
-  // specifically open Korg Nanokontrol2
-  libusb_device_handle *handle = libusb_open_device_with_vid_pid(usbctx,
-      KORG_NANOKONTROL2_VENDOR_ID, KORG_NANOKONTROL2_PRODUCT_ID);
-  if (handle == NULL) {
-    printf("Could not open device with Vendor:Product Id %04X:%04X\n",
-        KORG_NANOKONTROL2_VENDOR_ID, KORG_NANOKONTROL2_PRODUCT_ID);
-  } else {
-    const bool kernelWasActive = libusb_kernel_driver_active(handle, 0);
-    if (kernelWasActive) err = libusb_detach_kernel_driver(handle, 0);
-    if (err != 0) {
-      printf("Could not detach kernel: %s\n", libusb_error_name(err));
-    } else {
-      err = libusb_claim_interface(handle, 0);
-      if (err != 0) {
-        printf("Could not claim interface: %s\n", libusb_error_name(err));
-      } else {
-        libusb_device *device = libusb_get_device(handle);
-        const int maxPacketSize = libusb_get_max_packet_size(
-            device, KORG_NANOKONTROL2_ENDPOINT);
-        unsigned char usbBuffer[maxPacketSize];
-        int usbLen = 0;
-        while (_keepRunning) {
-          err = libusb_bulk_transfer(handle, KORG_NANOKONTROL2_ENDPOINT,
-              usbBuffer, maxPacketSize, &usbLen,
-              USB_BULK_TRANSFER_TIMEOUT_MS);
-          if (err == 0) {
-            // printf("[%i] ", usbLen); for (int j = 0; j < 4; j++) printf("%02X", usbBuffer[j]); printf("\n");
-            const char *address = getOscAddressForControl(usbBuffer[2]);
-            if (address != NULL) {
-              char oscBuffer[64];
-              const float f = usbBuffer[3] / 127.0f;
-              const int oscLen = tosc_writeMessage(
-                  oscBuffer, sizeof(oscBuffer), address, "f", f);
-              send(fd, oscBuffer, oscLen, 0); // send the OSC message
-            }
-          } else {
-            if (err != LIBUSB_ERROR_TIMEOUT) {
-              printf("Error while waiting for bulk transfer: %s\n",
-                  libusb_error_name(err));
-              _keepRunning = false;
-            }
-          }
-        }
-        libusb_release_interface(handle, 0);
+  // open all of the configured devices which are connected
+  Pending *pending = (Pending *) malloc(sizeof(Pending));
+  pending->config = config;
+  pending->numInFlight = 0;
+  pending_reset(pending);
+  for (int i = 0; i < config->numDevices; ++i) {
+    device_open(config->devices+i, usbctx, pending);
+  }
 
-        // reattach the kernel driver if necessary
-        if (kernelWasActive) libusb_attach_kernel_driver(handle, 0);
-      }
+  struct timespec windowStart = {0, 0};
+  while (_keepRunning && pending->numInFlight > 0) {
+    // handle the transfers which complete until the window closes
+    int64_t timeoutUs = USB_POLL_TIMEOUT_MS*1000LL;
+    if (pending->numChanges > 0) {
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      timeoutUs = windowUs - elapsedUs(&now, &windowStart);
+      if (timeoutUs < 0) timeoutUs = 0;
     }
-    libusb_close(handle);
+    struct timeval tv = {(time_t) (timeoutUs / 1000000), (suseconds_t) (timeoutUs % 1000000)};
+    const bool wasEmpty = (pending->numChanges == 0);
+    err = libusb_handle_events_timeout_completed(usbctx, &tv, NULL);
+    if (err != 0 && err != LIBUSB_ERROR_INTERRUPTED) {
+      printf("Error while handling USB events: %s\n", libusb_error_name(err));
+      break;
+    }
+    if (pending->numChanges == 0) continue;
+    if (wasEmpty) windowStart = pending->changes[0].t; // the window opens with the first change
+
+    // send everything in the window as one bundle
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (elapsedUs(&now, &windowStart) >= windowUs) pending_send(pending, fd);
   }
 
+  // cancel the transfers and wait for them to come back
+  for (int i = 0; i < config->numDevices; ++i) {
+    Device *d = config->devices+i;
+    if (d->handle == NULL) continue;
+    for (int j = 0; j < NUM_TRANSFERS; ++j) libusb_cancel_transfer(d->transfers[j]);
+  }
+  while (pending->numInFlight > 0) {
+    struct timeval tv = {0, USB_POLL_TIMEOUT_MS*1000};
+    if (libusb_handle_events_timeout_completed(usbctx, &tv, NULL) != 0) break;
+  }
+  for (int i = 0; i < config->numDevices; ++i) device_close(config->devices+i);
+  free(pending);
+  free(config);
+
   close(fd); // close the send socket
 
   libusb_exit(usbctx); // exit the usb context
@@ -176,13 +512,3 @@ void printInfoForNonSystemDevice(libusb_device *device) {
     libusb_close(handle);
   }
 }
-
-const char *getOscAddressForControl(const unsigned char c) {
-  switch (c) {
-    case 0:  return "/0/slider0";
-    case 7:  return "/0/gain";
-    case 16: return "/0/knob0";
-    case 23: return "/0/pan";
-    default: return NULL;
-  }
-}
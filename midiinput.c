@@ -0,0 +1,84 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#include <alsa/asoundlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include "midiinput.h"
+
+bool midiinput_open(MidiInput *o, const char *device) {
+  o->rawmidi = NULL;
+  o->status = 0;
+  o->numData = 0;
+  o->isSysex = false;
+  snd_rawmidi_t *rawmidi = NULL;
+  const int err = snd_rawmidi_open(&rawmidi, NULL, device, SND_RAWMIDI_NONBLOCK);
+  if (err < 0) {
+    printf("MIDI: %s: %s\n", device, snd_strerror(err));
+    return false;
+  }
+  o->rawmidi = rawmidi;
+  return true;
+}
+
+void midiinput_close(MidiInput *o) {
+  if (o->rawmidi == NULL) return;
+  snd_rawmidi_close((snd_rawmidi_t *) o->rawmidi);
+  o->rawmidi = NULL;
+}
+
+// the number of data bytes which follow a channel status byte
+static int getNumDataBytes(uint8_t status) {
+  switch (status & 0xF0) {
+    case 0xC0: // program change
+    case 0xD0: return 1; // channel pressure
+    default: return 2;
+  }
+}
+
+// returns true when b completes a message
+static bool midiinput_parse(MidiInput *o, uint8_t b, uint8_t *message) {
+  if (b >= 0xF8) return false; // real-time messages may appear anywhere, and are skipped
+  if (b & 0x80) {
+    o->isSysex = (b == 0xF0);
+    o->status = (b < 0xF0) ? b : 0; // system common messages cancel the running status
+    o->numData = 0;
+    return false;
+  }
+  if (o->isSysex || o->status == 0) return false;
+  o->data[o->numData++] = b;
+  if (o->numData < getNumDataBytes(o->status)) return false;
+  message[0] = o->status;
+  message[1] = o->data[0];
+  message[2] = (o->numData == 2) ? o->data[1] : 0;
+  o->numData = 0; // the status stays, for running status
+  return true;
+}
+
+int midiinput_read(MidiInput *o, int timeoutMs,
+    uint8_t messages[MIDIINPUT_MAX_MESSAGES][3], struct timespec *t) {
+  snd_rawmidi_t *rawmidi = (snd_rawmidi_t *) o->rawmidi;
+  struct pollfd fds[4];
+  int numFds = snd_rawmidi_poll_descriptors(rawmidi, fds, 4);
+  if (poll(fds, numFds, timeoutMs) <= 0) return 0;
+  clock_gettime(CLOCK_MONOTONIC, t); // as close to the arrival as we can get
+
+  unsigned short revents = 0;
+  snd_rawmidi_poll_descriptors_revents(rawmidi, fds, numFds, &revents);
+  if (revents & (POLLERR | POLLHUP)) return -1;
+  if (!(revents & POLLIN)) return 0;
+
+  // every message is at least one byte, so this many always fit
+  uint8_t buffer[MIDIINPUT_MAX_MESSAGES];
+  const ssize_t n = snd_rawmidi_read(rawmidi, buffer, sizeof(buffer));
+  if (n == -EAGAIN) return 0;
+  if (n < 0) {
+    printf("MIDI: %s\n", snd_strerror((int) n));
+    return -1;
+  }
+  int numMessages = 0;
+  for (ssize_t i = 0; i < n; ++i) {
+    if (midiinput_parse(o, buffer[i], messages[numMessages])) ++numMessages;
+  }
+  return numMessages;
+}
@@ -0,0 +1,39 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#ifndef _HARPY_MIDI_INPUT_
+#define _HARPY_MIDI_INPUT_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#define MIDIINPUT_MAX_MESSAGES 64 // per read
+
+/**
+ * Reads MIDI from an ALSA rawmidi device, such as any class-compliant USB
+ * controller (list them with $ amidi -l). The byte stream is parsed into
+ * channel messages, with running status. System messages are skipped.
+ */
+typedef struct {
+  void *rawmidi; // snd_rawmidi_t
+  uint8_t status;    // the running status, or 0 if there is none
+  uint8_t data[2];
+  int numData;       // data bytes received for the current message
+  bool isSysex;      // inside a system exclusive message, which is skipped
+} MidiInput;
+
+/** Opens the device, e.g. "hw:1,0,0". Returns false on failure. */
+bool midiinput_open(MidiInput *o, const char *device);
+
+void midiinput_close(MidiInput *o);
+
+/**
+ * Waits up to timeoutMs for input and parses everything which has arrived
+ * into messages of three bytes (status, data1, data2), all stamped with the
+ * monotonic time at which they were read. Returns the number of messages,
+ * or -1 if the device has gone away.
+ */
+int midiinput_read(MidiInput *o, int timeoutMs,
+    uint8_t messages[MIDIINPUT_MAX_MESSAGES][3], struct timespec *t);
+
+#endif // _HARPY_MIDI_INPUT_
@@ -0,0 +1,230 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "osctransport.h"
+
+// SLIP special bytes
+#define SLIP_END 0xC0
+#define SLIP_ESC 0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+static int openInetSocket(int type, int port) {
+  const int fd = socket(AF_INET, type, 0);
+  if (fd < 0) return -1;
+  const int yes = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  struct sockaddr_in sin;
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_port = htons(port);
+  sin.sin_addr.s_addr = INADDR_ANY;
+  if (bind(fd, (struct sockaddr *) &sin, sizeof(sin)) != 0 ||
+      (type == SOCK_STREAM && listen(fd, OSCTRANSPORT_MAX_STREAMS) != 0)) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int openUnixSocket(const char *path) {
+  struct sockaddr_un sun;
+  if (strlen(path) >= sizeof(sun.sun_path)) return -1;
+  const int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (fd < 0) return -1;
+  memset(&sun, 0, sizeof(sun));
+  sun.sun_family = AF_UNIX;
+  strcpy(sun.sun_path, path);
+  unlink(path); // remove a socket left behind by a previous run
+  if (bind(fd, (struct sockaddr *) &sun, sizeof(sun)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool osctransport_init(OscTransport *o, int udpPort, int tcpPort,
+    const char *unixPath, OscPacketHook *hook, void *userData) {
+  o->hook = hook;
+  o->userData = userData;
+  o->udpFd = -1;
+  o->tcpFd = -1;
+  o->unixFd = -1;
+  o->unixPath[0] = '\0';
+  for (int i = 0; i < OSCTRANSPORT_MAX_STREAMS; ++i) {
+    o->streams[i].fd = -1;
+    o->streams[i].packet = NULL;
+  }
+
+  bool success = true;
+  if (udpPort > 0) {
+    o->udpFd = openInetSocket(SOCK_DGRAM, udpPort);
+    if (o->udpFd < 0) {
+      printf("Could not open OSC UDP port %i\n", udpPort);
+      success = false;
+    }
+  }
+  if (tcpPort > 0) {
+    o->tcpFd = openInetSocket(SOCK_STREAM, tcpPort);
+    if (o->tcpFd < 0) {
+      printf("Could not open OSC TCP port %i\n", tcpPort);
+      success = false;
+    }
+  }
+  if (unixPath != NULL && unixPath[0] != '\0') {
+    o->unixFd = openUnixSocket(unixPath);
+    if (o->unixFd < 0) {
+      printf("Could not open OSC socket %s\n", unixPath);
+      success = false;
+    } else {
+      strcpy(o->unixPath, unixPath);
+      printf("harpy is listening on osc.unix://%s\n", unixPath);
+    }
+  }
+  return success;
+}
+
+static void stream_close(OscStream *s) {
+  close(s->fd);
+  free(s->packet);
+  s->packet = NULL;
+  s->fd = -1;
+}
+
+void osctransport_free(OscTransport *o) {
+  for (int i = 0; i < OSCTRANSPORT_MAX_STREAMS; ++i) {
+    if (o->streams[i].fd >= 0) stream_close(o->streams+i);
+  }
+  if (o->udpFd >= 0) close(o->udpFd);
+  if (o->tcpFd >= 0) close(o->tcpFd);
+  if (o->unixFd >= 0) {
+    close(o->unixFd);
+    unlink(o->unixPath);
+  }
+}
+
+static void osctransport_accept(OscTransport *o) {
+  const int fd = accept(o->tcpFd, NULL, NULL);
+  if (fd < 0) return;
+  for (int i = 0; i < OSCTRANSPORT_MAX_STREAMS; ++i) {
+    OscStream *s = o->streams+i;
+    if (s->fd < 0) {
+      const int yes = 1; // replies are small, don't wait to coalesce them
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+      s->fd = fd;
+      s->framing = OSC_FRAMING_NONE;
+      s->packet = (char *) malloc(OSCTRANSPORT_MAX_PACKET);
+      s->len = 0;
+      s->size = 0;
+      s->numHeader = 0;
+      s->isEscaped = false;
+      s->isDiscarding = false;
+      return;
+    }
+  }
+  close(fd); // too many connections
+}
+
+// reassembles length-prefixed packets from n received bytes
+static void stream_readLength(OscTransport *o, OscStream *s, const char *b, int n) {
+  while (n > 0) {
+    if (s->numHeader < 4) {
+      s->size = (s->size << 8) | (unsigned char) *b++; --n;
+      if (++s->numHeader == 4) {
+        s->len = 0;
+        s->isDiscarding = (s->size > OSCTRANSPORT_MAX_PACKET);
+      } else continue;
+    }
+    const uint32_t k = (s->size-s->len < (uint32_t) n) ? (s->size-s->len) : (uint32_t) n;
+    if (!s->isDiscarding) memcpy(s->packet+s->len, b, k);
+    s->len += k;
+    b += k; n -= k;
+    if (s->len == s->size) {
+      if (!s->isDiscarding && s->size > 0) o->hook(s->packet, (int) s->size, o->userData);
+      s->numHeader = 0;
+      s->size = 0;
+    }
+  }
+}
+
+// decodes SLIP packets from n received bytes
+static void stream_readSlip(OscTransport *o, OscStream *s, const char *b, int n) {
+  for (int i = 0; i < n; ++i) {
+    unsigned char c = (unsigned char) b[i];
+    if (c == SLIP_END) {
+      // empty packets, such as from a leading END, are ignored
+      if (!s->isDiscarding && s->len > 0) o->hook(s->packet, (int) s->len, o->userData);
+      s->len = 0;
+      s->isEscaped = false;
+      s->isDiscarding = false;
+      continue;
+    }
+    if (s->isEscaped) {
+      c = (c == SLIP_ESC_END) ? SLIP_END : (c == SLIP_ESC_ESC) ? SLIP_ESC : c;
+      s->isEscaped = false;
+    } else if (c == SLIP_ESC) {
+      s->isEscaped = true;
+      continue;
+    }
+    if (s->len == OSCTRANSPORT_MAX_PACKET) s->isDiscarding = true;
+    else s->packet[s->len++] = (char) c;
+  }
+}
+
+static void stream_read(OscTransport *o, OscStream *s) {
+  const int n = (int) recv(s->fd, o->buffer, sizeof(o->buffer), 0);
+  if (n <= 0) {
+    stream_close(s); // the connection was closed
+    return;
+  }
+  if (s->framing == OSC_FRAMING_NONE) {
+    // a length prefix starts with a zero byte (for packets under 16MB),
+    // whereas a SLIP packet starts with END or with '/' or '#'
+    s->framing = (o->buffer[0] == 0) ? OSC_FRAMING_LENGTH : OSC_FRAMING_SLIP;
+  }
+  if (s->framing == OSC_FRAMING_LENGTH) stream_readLength(o, s, o->buffer, n);
+  else stream_readSlip(o, s, o->buffer, n);
+}
+
+static void osctransport_readDatagram(OscTransport *o, int fd) {
+  const int n = (int) recv(fd, o->buffer, sizeof(o->buffer), 0);
+  if (n > 0) o->hook(o->buffer, n, o->userData);
+}
+
+void osctransport_poll(OscTransport *o, int timeoutMs) {
+  struct pollfd fds[3+OSCTRANSPORT_MAX_STREAMS];
+  OscStream *streams[OSCTRANSPORT_MAX_STREAMS];
+  int n = 0;
+  const int fixed[3] = {o->udpFd, o->unixFd, o->tcpFd};
+  for (int i = 0; i < 3; ++i) {
+    fds[i].fd = fixed[i]; // negative descriptors are ignored by poll()
+    fds[i].events = POLLIN;
+    fds[i].revents = 0;
+  }
+  for (int i = 0; i < OSCTRANSPORT_MAX_STREAMS; ++i) {
+    if (o->streams[i].fd >= 0) {
+      fds[3+n].fd = o->streams[i].fd;
+      fds[3+n].events = POLLIN;
+      fds[3+n].revents = 0;
+      streams[n++] = o->streams+i;
+    }
+  }
+
+  if (poll(fds, 3+n, timeoutMs) <= 0) return;
+
+  if (fds[0].revents & POLLIN) osctransport_readDatagram(o, o->udpFd);
+  if (fds[1].revents & POLLIN) osctransport_readDatagram(o, o->unixFd);
+  for (int i = 0; i < n; ++i) {
+    if (fds[3+i].revents & (POLLIN | POLLHUP | POLLERR)) stream_read(o, streams[i]);
+  }
+  if (fds[2].revents & POLLIN) osctransport_accept(o);
+}
@@ -0,0 +1,64 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#ifndef _HARPY_OSC_TRANSPORT_
+#define _HARPY_OSC_TRANSPORT_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define OSCTRANSPORT_MAX_PACKET 8192 // bytes
+#define OSCTRANSPORT_MAX_STREAMS 8   // simultaneous TCP connections
+
+// called with each complete OSC packet, from whichever transport it arrived on
+typedef void (OscPacketHook)(char *buffer, int len, void *userData);
+
+typedef enum {
+  OSC_FRAMING_NONE,   // not yet known
+  OSC_FRAMING_LENGTH, // OSC 1.0, each packet is preceded by its big-endian int32 length
+  OSC_FRAMING_SLIP    // OSC 1.1, packets are SLIP encoded (RFC 1055)
+} OscFraming;
+
+// a TCP connection, and the packet that is currently being received on it
+typedef struct {
+  int fd; // -1 if unused
+  OscFraming framing;
+  char *packet;       // the packet received so far
+  uint32_t len;       // the number of bytes in packet
+  uint32_t size;      // length framing, the size of the packet
+  uint32_t numHeader; // length framing, the number of length bytes received
+  bool isEscaped;     // SLIP framing, the last byte was ESC
+  bool isDiscarding;  // the packet is too large and is being skipped
+} OscStream;
+
+/**
+ * Receives OSC packets on UDP, TCP and an AF_UNIX datagram socket, all
+ * multiplexed in one poll() loop. TCP connections may use either the length
+ * prefix or SLIP framing, which is detected from the first byte received.
+ */
+typedef struct {
+  int udpFd;     // -1 if disabled
+  int tcpFd;     // the listening socket, -1 if disabled
+  int unixFd;    // -1 if disabled
+  char unixPath[108];
+  OscStream streams[OSCTRANSPORT_MAX_STREAMS];
+  OscPacketHook *hook;
+  void *userData;
+  char buffer[OSCTRANSPORT_MAX_PACKET]; // receive buffer
+} OscTransport;
+
+/**
+ * Opens the sockets. A port of 0 or a NULL path disables that transport.
+ * Returns false if any enabled transport could not be opened.
+ */
+bool osctransport_init(OscTransport *o, int udpPort, int tcpPort,
+    const char *unixPath, OscPacketHook *hook, void *userData);
+
+void osctransport_free(OscTransport *o);
+
+/**
+ * Waits up to timeoutMs for data on any socket, and calls the hook with
+ * every complete packet which has arrived.
+ */
+void osctransport_poll(OscTransport *o, int timeoutMs);
+
+#endif // _HARPY_OSC_TRANSPORT_
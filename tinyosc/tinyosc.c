@@ -28,12 +28,36 @@
 
 #define BUNDLE_ID 0x2362756E646C6500L // "#bundle"
 
+// elements of nested bundles are only 4-byte aligned, so 8-byte fields are
+// accessed through memcpy
+static inline uint32_t tosc_load32(const char *p) {
+  uint32_t x;
+  memcpy(&x, p, 4); // a single load, regardless of the alignment of the buffer
+  return ntohl(x);
+}
+
+static inline uint64_t tosc_load64(const char *p) {
+  uint64_t x;
+  memcpy(&x, p, 8);
+  return ntohll(x);
+}
+
+static inline void tosc_store32(char *p, uint32_t x) {
+  x = htonl(x);
+  memcpy(p, &x, 4);
+}
+
+static inline void tosc_store64(char *p, uint64_t x) {
+  x = htonll(x);
+  memcpy(p, &x, 8);
+}
+
 // http://opensoundcontrol.org/spec-1_0
 int tosc_parseMessage(tosc_message *o, char *buffer, const int len) {
   // NOTE(mhroth): if there's a comma in the address, that's weird
   int i = 0;
-  while (buffer[i] != '\0') ++i; // find the null-terimated address
-  while (buffer[i] != ',') ++i; // find the comma which starts the format string
+  while (i < len && buffer[i] != '\0') ++i; // find the null-terimated address
+  while (i < len && buffer[i] != ',') ++i; // find the comma which starts the format string
   if (i >= len) return -1; // error while looking for format string
   // format string is null terminated
   o->format = buffer + i + 1; // format starts after comma
@@ -52,7 +76,7 @@ int tosc_parseMessage(tosc_message *o, char *buffer, const int len) {
 
 // check if first eight bytes are '#bundle '
 bool tosc_isBundle(const char *buffer) {
-  return ((*(const int64_t *) buffer) == htonll(BUNDLE_ID));
+  return tosc_load64(buffer) == BUNDLE_ID;
 }
 
 void tosc_parseBundle(tosc_bundle *b, char *buffer, const int len) {
@@ -63,21 +87,35 @@ void tosc_parseBundle(tosc_bundle *b, char *buffer, const int len) {
 }
 
 uint64_t tosc_getTimetag(tosc_bundle *b) {
-  return ntohll(*((uint64_t *) (b->buffer+8)));
+  return tosc_load64(b->buffer+8);
 }
 
 uint32_t tosc_getBundleLength(tosc_bundle *b) {
   return b->bundleLen;
 }
 
-bool tosc_getNextMessage(tosc_bundle *b, tosc_message *o) {
-  if ((b->marker - b->buffer) >= b->bundleLen) return false;
-  uint32_t len = (uint32_t) ntohl(*((int32_t *) b->marker));
-  tosc_parseMessage(o, b->marker+4, len);
-  b->marker += (4 + len); // move marker to next bundle element
+bool tosc_getNextElement(tosc_bundle *b, char **buffer, uint32_t *len) {
+  const uint32_t remaining = b->bundleLen - (uint32_t) (b->marker - b->buffer);
+  if ((b->marker - b->buffer) >= b->bundleLen || remaining < 4) return false;
+  const uint32_t l = (uint32_t) ntohl(*((int32_t *) b->marker));
+  // the element must fit in the bundle and be a multiple of 4 bytes long
+  if (l == 0 || l > remaining - 4 || (l & 0x3)) return false;
+  *buffer = b->marker + 4;
+  *len = l;
+  b->marker += (4 + l); // move marker to next bundle element
   return true;
 }
 
+bool tosc_getNextMessage(tosc_bundle *b, tosc_message *o) {
+  char *buffer = NULL;
+  uint32_t len = 0;
+  while (tosc_getNextElement(b, &buffer, &len)) {
+    if (len >= 16 && tosc_isBundle(buffer)) continue; // skip nested bundles
+    return (tosc_parseMessage(o, buffer, len) == 0);
+  }
+  return false;
+}
+
 char *tosc_getAddress(tosc_message *o) {
   return o->buffer;
 }
@@ -98,7 +136,7 @@ int32_t tosc_getNextInt32(tosc_message *o) {
 }
 
 int64_t tosc_getNextInt64(tosc_message *o) {
-  const int64_t i = (int64_t) ntohll(*((uint64_t *) o->marker));
+  const int64_t i = (int64_t) tosc_load64(o->marker);
   o->marker += 8;
   return i;
 }
@@ -115,7 +153,7 @@ float tosc_getNextFloat(tosc_message *o) {
 }
 
 double tosc_getNextDouble(tosc_message *o) {
-  const uint64_t i = ntohll(*((uint64_t *) o->marker));
+  const uint64_t i = tosc_load64(o->marker);
   o->marker += 8;
   return *((double *) (&i));
 }
@@ -148,9 +186,89 @@ unsigned char *tosc_getNextMidi(tosc_message *o) {
   return m;
 }
 
+// Returns the offset after the padded, null-terminated string at i, or -1 if
+// it is not terminated before len. Strings start and end on 4-byte
+// boundaries, so they are scanned a word at a time.
+static int tosc_skipString(const char *buffer, int i, const int len, int32_t *strLen) {
+  const int start = i;
+  for (; i < len; i += 4) {
+    const uint32_t w = tosc_load32(buffer+i);
+    if ((w - 0x01010101U) & ~w & 0x80808080U) { // the word contains a zero byte
+      int j = 0;
+      while (buffer[i+j] != '\0') ++j;
+      *strLen = i + j - start;
+      return i + 4;
+    }
+  }
+  return -1;
+}
+
+int tosc_decodeMessage(tosc_decoded *o, const char *buffer, const int len) {
+  if (len <= 0 || (len & 0x3) || buffer[0] != '/') return -1;
+  int32_t n = 0;
+  int i = tosc_skipString(buffer, 0, len, &n);
+  if (i < 0) return -2;
+  if (i >= len || buffer[i] != ',') return -3;
+  o->address = buffer;
+  o->format = buffer + i + 1;
+  i = tosc_skipString(buffer, i, len, &n);
+  if (i < 0) return -3;
+  if (n-1 > TINYOSC_MAX_ARGS) return -4;
+  o->numArgs = n-1;
+
+  for (int k = 0; k < o->numArgs; ++k) {
+    tosc_arg *const a = o->args + k;
+    switch (o->format[k]) {
+      case 'i':
+      case 'f': {
+        if (len - i < 4) return -5;
+        a->i = (int32_t) tosc_load32(buffer+i); // a float is decoded as its bits
+        i += 4;
+        break;
+      }
+      case 'm': {
+        if (len - i < 4) return -5;
+        a->m = (const unsigned char *) (buffer+i);
+        i += 4;
+        break;
+      }
+      case 'h':
+      case 't':
+      case 'd': {
+        if (len - i < 8) return -5;
+        a->t = tosc_load64(buffer+i);
+        i += 8;
+        break;
+      }
+      case 's': {
+        a->s = buffer+i;
+        i = tosc_skipString(buffer, i, len, &a->len);
+        if (i < 0) return -5;
+        break;
+      }
+      case 'b': {
+        if (len - i < 4) return -5;
+        const uint32_t size = tosc_load32(buffer+i);
+        if (size > (uint32_t) (len - i - 4)) return -5;
+        a->b = buffer + i + 4;
+        a->len = (int32_t) size;
+        i += 4 + ((size + 3) & ~0x3); // len is a multiple of 4, so this fits
+        break;
+      }
+      case 'T': a->i = 1; break;
+      case 'F':
+      case 'N':
+      case 'I': a->i = 0; break;
+      default: return -5; // unknown type
+    }
+  }
+
+  return (i == len) ? 0 : -6;
+}
+
 void tosc_writeBundle(tosc_bundle *b, uint64_t timetag, char *buffer, const int len) {
-  *((uint64_t *) buffer) = htonll(BUNDLE_ID);
-  *((uint64_t *) (buffer + 8)) = htonll(timetag);
+  tosc_store64(buffer, BUNDLE_ID);
+  tosc_store64(buffer + 8, timetag);
 
   b->buffer = buffer;
   b->marker = buffer + 16;
@@ -178,7 +296,7 @@ static uint32_t tosc_vwrite(char *buffer, const int len,
         const uint32_t n = (uint32_t) va_arg(ap, int); // length of blob
         if (i + 4 + n > len) return -3;
         char *b = (char *) va_arg(ap, void *); // pointer to binary data
-        *((uint32_t *) (buffer+i)) = htonl(n); i += 4;
+        tosc_store32(buffer+i, n); i += 4;
         memcpy(buffer+i, b, n);
         i = (i + 3 + n) & ~0x3;
         break;
@@ -186,21 +304,25 @@ static uint32_t tosc_vwrite(char *buffer, const int len,
       case 'f': {
         if (i + 4 > len) return -3;
         const float f = (float) va_arg(ap, double);
-        *((uint32_t *) (buffer+i)) = htonl(*((uint32_t *) &f));
+        uint32_t k;
+        memcpy(&k, &f, 4);
+        tosc_store32(buffer+i, k);
         i += 4;
         break;
       }
       case 'd': {
         if (i + 8 > len) return -3;
         const double f = (double) va_arg(ap, double);
-        *((uint64_t *) (buffer+i)) = htonll(*((uint64_t *) &f));
+        uint64_t k;
+        memcpy(&k, &f, 8);
+        tosc_store64(buffer+i, k);
         i += 8;
         break;
       }
       case 'i': {
         if (i + 4 > len) return -3;
         const uint32_t k = (uint32_t) va_arg(ap, int);
-        *((uint32_t *) (buffer+i)) = htonl(k);
+        tosc_store32(buffer+i, k);
         i += 4;
         break;
       }
@@ -215,7 +337,7 @@ static uint32_t tosc_vwrite(char *buffer, const int len,
       case 'h': {
         if (i + 8 > len) return -3;
         const uint64_t k = (uint64_t) va_arg(ap, long long);
-        *((uint64_t *) (buffer+i)) = htonll(k);
+        tosc_store64(buffer+i, k);
         i += 8;
         break;
       }
@@ -247,7 +369,82 @@ uint32_t tosc_writeNextMessage(tosc_bundle *b,
   const uint32_t i = tosc_vwrite(
       b->marker+4, b->bufLen-b->bundleLen-4, address, format, ap);
   va_end(ap);
-  *((uint32_t *) b->marker) = htonl(i); // write the length of the message
+  tosc_store32(b->marker, i); // write the length of the message
+  b->marker += (4 + i);
+  b->bundleLen += (4 + i);
+  return i;
+}
+
+// writes a padded string, returns the new offset or 0 if it does not fit
+static uint32_t tosc_writeString(char *buffer, uint32_t i, const uint32_t len,
+    const char *str) {
+  const uint32_t n = (uint32_t) strlen(str);
+  const uint32_t end = (i + 4 + n) & ~0x3;
+  if (end > len) return 0;
+  memcpy(buffer+i, str, n);
+  memset(buffer+i+n, 0, end-i-n);
+  return end;
+}
+
+uint32_t tosc_writeNextMessageWithArgs(tosc_bundle *b,
+    const char *address, const char *format, const tosc_arg *args) {
+  if (b->bundleLen + 4 > b->bufLen) return 0;
+  char *const buffer = b->marker + 4;
+  const uint32_t len = b->bufLen - b->bundleLen - 4;
+  uint32_t i = tosc_writeString(buffer, 0, len, address);
+  if (i == 0 || i == len) return 0;
+  buffer[i] = ',';
+  i = tosc_writeString(buffer, i+1, len, format);
+  if (i == 0) return 0;
+
+  for (int j = 0; format[j] != '\0'; ++j) {
+    const tosc_arg *a = args + j;
+    switch (format[j]) {
+      case 'i':
+      case 'f': {
+        if (i + 4 > len) return 0;
+        tosc_store32(buffer+i, (uint32_t) a->i);
+        i += 4;
+        break;
+      }
+      case 'm': {
+        if (i + 4 > len) return 0;
+        memcpy(buffer+i, a->m, 4);
+        i += 4;
+        break;
+      }
+      case 'h':
+      case 't':
+      case 'd': {
+        if (i + 8 > len) return 0;
+        tosc_store64(buffer+i, a->t);
+        i += 8;
+        break;
+      }
+      case 's': {
+        i = tosc_writeString(buffer, i, len, a->s);
+        if (i == 0) return 0;
+        break;
+      }
+      case 'b': {
+        const uint32_t n = (uint32_t) a->len;
+        const uint32_t end = (i + 7 + n) & ~0x3;
+        if (end > len) return 0;
+        tosc_store32(buffer+i, n);
+        memcpy(buffer+i+4, a->b, n);
+        memset(buffer+i+4+n, 0, end-i-4-n);
+        i = end;
+        break;
+      }
+      case 'T':
+      case 'F':
+      case 'N':
+      case 'I': break;
+      default: return 0; // unknown type
+    }
+  }
+
+  tosc_store32(b->marker, i); // write the length of the message
   b->marker += (4 + i);
   b->bundleLen += (4 + i);
   return i;
@@ -21,6 +21,7 @@
 #include <stdint.h>
 
 #define TINYOSC_TIMETAG_IMMEDIATELY 1L
+#define TINYOSC_MAX_ARGS 16
 
 #ifdef __cplusplus
 extern "C" {
@@ -40,6 +41,27 @@ typedef struct tosc_bundle {
   uint32_t bundleLen; // the byte length of the total bundle
 } tosc_bundle;
 
+typedef struct tosc_arg {
+  union {
+    int32_t i;              // 'i', and 1 or 0 for 'T' and 'F'
+    float f;                // 'f'
+    int64_t h;              // 'h'
+    uint64_t t;             // 't'
+    double d;               // 'd'
+    const char *s;          // 's', null-terminated
+    const char *b;          // 'b'
+    const unsigned char *m; // 'm', port id, status byte, data1, data2
+  };
+  int32_t len; // the byte length of a string or blob
+} tosc_arg;
+
+typedef struct tosc_decoded {
+  const char *address; // points into the original buffer
+  const char *format;  // the format string, without the leading ','
+  int numArgs;
+  tosc_arg args[TINYOSC_MAX_ARGS];
+} tosc_decoded;
+
 
 
 /**
@@ -59,10 +81,18 @@ uint64_t tosc_getTimetag(tosc_bundle *b);
 
 /**
  * Parses the next message in a bundle. Returns true if successful.
- * False otherwise.
+ * False otherwise. Nested bundles are skipped, use tosc_getNextElement()
+ * to read them.
  */
 bool tosc_getNextMessage(tosc_bundle *b, tosc_message *o);
 
+/**
+ * Points buffer to the next element of a bundle, which is either a message
+ * or a nested bundle, and sets len to its length. Returns false at the end
+ * of the bundle, or if the element does not fit in it.
+ */
+bool tosc_getNextElement(tosc_bundle *b, char **buffer, uint32_t *len);
+
 /**
  * Returns a point to the address block of the OSC buffer.
  * This is also the start of the buffer.
@@ -130,6 +160,20 @@ unsigned char *tosc_getNextMidi(tosc_message *o);
  */
 int tosc_parseMessage(tosc_message *o, char *buffer, const int len);
 
+/**
+ * Validates and decodes an entire OSC message in one pass. All arguments are
+ * converted to host byte order in o->args, so that they can be read without
+ * touching the buffer again. Strings and blobs point into the buffer.
+ * Returns 0 if the message is well-formed, otherwise a negative error code:
+ *   -1 the length is not a positive multiple of 4, or the address is missing
+ *   -2 the address is not null-terminated
+ *   -3 the format string is missing or not null-terminated
+ *   -4 there are more than TINYOSC_MAX_ARGS arguments
+ *   -5 an argument exceeds the buffer, or a type is unknown
+ *   -6 there are trailing bytes after the last argument
+ */
+int tosc_decodeMessage(tosc_decoded *o, const char *buffer, const int len);
+
 /**
  * Starts writing a bundle to the given buffer with length.
  */
@@ -141,6 +185,14 @@ void tosc_writeBundle(tosc_bundle *b, uint64_t timetag, char *buffer, const int
 uint32_t tosc_writeNextMessage(tosc_bundle *b,
     const char *address, const char *format, ...);
 
+/**
+ * Write a message to a bundle buffer, taking the arguments from an array
+ * such as one filled by tosc_decodeMessage(). Returns the number of bytes
+ * written, or 0 if the message does not fit (the bundle is unchanged).
+ */
+uint32_t tosc_writeNextMessageWithArgs(tosc_bundle *b,
+    const char *address, const char *format, const tosc_arg *args);
+
 /**
  * Returns the length in bytes of the bundle.
  */
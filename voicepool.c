@@ -0,0 +1,247 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "voicepool.h"
+
+static void voice_process(VoicePool *o, Voice *v) {
+  // Voices above the polyphony limit are frozen once they have faded out. They
+  // are not heard, but their clocks keep running and the blocks in which
+  // messages are due are still processed, so that controls sent to every voice
+  // are up to date when they are restored.
+  if (v - o->voices >= o->maxVoices && !v->isFadingOut) {
+    v->isSleeping = true;
+    v->silentBlocks = VOICEPOOL_SILENT_BLOCKS; // restored asleep
+    if (hv_skipBlock(v->context, o->blockSize) == 0) {
+      o->f.process(v->context, NULL, v->outputBuffers, o->blockSize);
+    }
+    return;
+  }
+
+  // a silent voice sleeps until a message is due
+  if (v->silentBlocks >= VOICEPOOL_SILENT_BLOCKS) {
+    if (hv_skipBlock(v->context, o->blockSize) > 0) {
+      v->isSleeping = true;
+      v->isFadingOut = false; // already silent
+      return;
+    }
+    v->silentBlocks = 0; // woken up, start counting silence again
+  }
+  v->isSleeping = false;
+
+  o->f.process(v->context, NULL, v->outputBuffers, o->blockSize);
+
+  if (v->isFadingOut) {
+    const float k = 1.0f / o->blockSize;
+    for (int i = 0; i < VOICEPOOL_NUM_CHANNELS; ++i) {
+      for (int j = 0; j < o->blockSize; ++j) {
+        v->outputBuffers[i][j] *= 1.0f - k*j;
+      }
+    }
+    v->isFadingOut = false;
+  }
+
+  for (int i = 0; i < VOICEPOOL_NUM_CHANNELS; ++i) {
+    for (int j = 0; j < o->blockSize; ++j) {
+      if (fabsf(v->outputBuffers[i][j]) > VOICEPOOL_SILENCE_THRESHOLD) {
+        v->silentBlocks = 0;
+        return;
+      }
+    }
+  }
+  ++v->silentBlocks;
+}
+
+// process voices until there are none left for this block
+static void voicepool_work(VoicePool *o) {
+  int i;
+  while ((i = atomic_fetch_add(&o->nextVoice, 1)) < o->numVoices) {
+    voice_process(o, o->voices+i);
+  }
+}
+
+static void *voicepool_run(void *x) {
+  VoicePool *o = (VoicePool *) x;
+  while (true) {
+    pthread_barrier_wait(&o->startBarrier);
+    if (!o->isRunning) break;
+    voicepool_work(o);
+    pthread_barrier_wait(&o->doneBarrier);
+  }
+  return NULL;
+}
+
+void voicepool_init(VoicePool *o, const VoiceContextFunctions *f,
+    int numVoices, int numThreads, double sampleRate, int blockSize) {
+  o->f = *f;
+  o->numVoices = numVoices;
+  o->maxVoices = numVoices;
+  o->blockSize = blockSize;
+  o->numNotes = 0;
+  o->voices = (Voice *) malloc(numVoices*sizeof(Voice));
+  for (int i = 0; i < numVoices; ++i) {
+    Voice *v = o->voices+i;
+    v->context = o->f.newContext(sampleRate);
+    for (int j = 0; j < VOICEPOOL_NUM_CHANNELS; ++j) {
+      v->outputBuffers[j] = (float *) aligned_alloc(32, blockSize*sizeof(float));
+    }
+    v->pitch = -1;
+    v->age = 0;
+    v->silentBlocks = VOICEPOOL_SILENT_BLOCKS; // start asleep
+    v->isSleeping = true;
+    v->isFadingOut = false;
+  }
+
+  atomic_init(&o->nextVoice, 0);
+  o->isRunning = true;
+  o->numThreads = (numThreads > 1) ? (numThreads-1) : 0;
+  o->threads = NULL;
+  if (o->numThreads > 0) {
+    pthread_barrier_init(&o->startBarrier, NULL, o->numThreads+1);
+    pthread_barrier_init(&o->doneBarrier, NULL, o->numThreads+1);
+    o->threads = (pthread_t *) malloc(o->numThreads*sizeof(pthread_t));
+    for (int i = 0; i < o->numThreads; ++i) {
+      pthread_create(o->threads+i, NULL, &voicepool_run, o);
+    }
+  }
+}
+
+void voicepool_free(VoicePool *o) {
+  if (o->numThreads > 0) {
+    o->isRunning = false;
+    pthread_barrier_wait(&o->startBarrier); // release the workers
+    for (int i = 0; i < o->numThreads; ++i) {
+      pthread_join(o->threads[i], NULL);
+    }
+    pthread_barrier_destroy(&o->startBarrier);
+    pthread_barrier_destroy(&o->doneBarrier);
+    free(o->threads);
+    o->threads = NULL;
+    o->numThreads = 0;
+  }
+
+  for (int i = 0; i < o->numVoices; ++i) {
+    o->f.freeContext(o->voices[i].context);
+    for (int j = 0; j < VOICEPOOL_NUM_CHANNELS; ++j) {
+      free(o->voices[i].outputBuffers[j]);
+    }
+  }
+  free(o->voices);
+  o->voices = NULL;
+  o->numVoices = 0;
+}
+
+void voicepool_scheduleFloatForReceiver(VoicePool *o, double delayMs,
+    const char *receiverName, float x) {
+  for (int i = 0; i < o->numVoices; ++i) {
+    hv_vscheduleMessageForReceiver(o->voices[i].context, receiverName, delayMs, "f", x);
+  }
+}
+
+static void voice_scheduleNote(Voice *v, double delayMs,
+    int pitch, int velocity, int channel, int command) {
+  hv_vscheduleMessageForReceiver(v->context,
+      "__hv_notein", delayMs, "fffff",
+      (float) velocity,
+      (float) pitch,
+      (float) channel,
+      (float) command,
+      0.0f); // port
+}
+
+static Voice *voicepool_getVoiceForPitch(VoicePool *o, int pitch) {
+  for (int i = 0; i < o->maxVoices; ++i) {
+    if (o->voices[i].pitch == pitch) return o->voices+i;
+  }
+  return NULL;
+}
+
+// the released voice which has been silent the longest, else the oldest held voice
+static Voice *voicepool_getFreeVoice(VoicePool *o) {
+  Voice *released = NULL;
+  Voice *held = NULL;
+  for (int i = 0; i < o->maxVoices; ++i) {
+    Voice *v = o->voices+i;
+    if (v->pitch < 0) {
+      if (released == NULL || v->silentBlocks > released->silentBlocks ||
+          (v->silentBlocks == released->silentBlocks && v->age < released->age)) {
+        released = v;
+      }
+    } else if (held == NULL || v->age < held->age) {
+      held = v;
+    }
+  }
+  return (released != NULL) ? released : held;
+}
+
+void voicepool_scheduleNote(VoicePool *o, double delayMs,
+    int pitch, int velocity, int channel, int command) {
+  if (command == 0x80 || velocity == 0) {
+    // note off
+    Voice *v = voicepool_getVoiceForPitch(o, pitch);
+    if (v != NULL) {
+      voice_scheduleNote(v, delayMs, pitch, velocity, channel, command);
+      v->pitch = -1;
+    }
+  } else {
+    // note on
+    Voice *v = voicepool_getVoiceForPitch(o, pitch);
+    if (v == NULL) {
+      v = voicepool_getFreeVoice(o);
+      if (v == NULL) return; // the slot has been shut off
+      if (v->pitch >= 0) {
+        // steal the voice, releasing its current note first
+        voice_scheduleNote(v, delayMs, v->pitch, 0, channel, 0x80);
+      }
+    }
+    voice_scheduleNote(v, delayMs, pitch, velocity, channel, command);
+    v->pitch = pitch;
+    v->age = ++o->numNotes;
+    v->silentBlocks = 0; // keep the voice awake from now on
+  }
+}
+
+void voicepool_setMaxVoices(VoicePool *o, int n) {
+  n = (n < 0) ? 0 : (n > o->numVoices) ? o->numVoices : n;
+  for (int i = n; i < o->maxVoices; ++i) {
+    Voice *v = o->voices+i;
+    if (v->pitch >= 0) {
+      voice_scheduleNote(v, 0.0, v->pitch, 0, 0, 0x80);
+      v->pitch = -1;
+    }
+    v->isFadingOut = !v->isSleeping;
+  }
+  o->maxVoices = n;
+}
+
+void voicepool_process(VoicePool *o, float **outputBuffers) {
+  // only wake the workers if more than one voice is likely to need processing
+  int numAwake = 0;
+  for (int i = 0; i < o->maxVoices; ++i) {
+    if (o->voices[i].silentBlocks < VOICEPOOL_SILENT_BLOCKS) ++numAwake;
+  }
+
+  atomic_store(&o->nextVoice, 0);
+  if (o->numThreads > 0 && numAwake > 1) {
+    pthread_barrier_wait(&o->startBarrier);
+    voicepool_work(o);
+    pthread_barrier_wait(&o->doneBarrier);
+  } else {
+    voicepool_work(o);
+  }
+
+  // sum all voices into the output bus
+  for (int i = 0; i < VOICEPOOL_NUM_CHANNELS; ++i) {
+    memset(outputBuffers[i], 0, o->blockSize*sizeof(float));
+  }
+  for (int i = 0; i < o->numVoices; ++i) {
+    const Voice *v = o->voices+i;
+    if (v->isSleeping) continue;
+    for (int j = 0; j < VOICEPOOL_NUM_CHANNELS; ++j) {
+      for (int k = 0; k < o->blockSize; ++k) {
+        outputBuffers[j][k] += v->outputBuffers[j][k];
+      }
+    }
+  }
+}
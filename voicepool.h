@@ -0,0 +1,85 @@
+/* Copyright (c) 2015, Martin Roth (mhroth@gmail.com). All Rights Reserved. */
+
+#ifndef _HARPY_VOICE_POOL_
+#define _HARPY_VOICE_POOL_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "heavy/mixer/Heavy_mixer.h" // the common Heavy API
+
+#define VOICEPOOL_NUM_CHANNELS 2
+
+// a voice whose output stays below this level for VOICEPOOL_SILENT_BLOCKS blocks is put to sleep
+#define VOICEPOOL_SILENCE_THRESHOLD 0.00001f // -100dB
+#define VOICEPOOL_SILENT_BLOCKS 16
+
+typedef struct {
+  Heavy *(*newContext)(double sampleRate);
+  int (*process)(Heavy *c, float **inputBuffers, float **outputBuffers, int n);
+  void (*freeContext)(Heavy *c);
+} VoiceContextFunctions;
+
+typedef struct {
+  Heavy *context;
+  float *outputBuffers[VOICEPOOL_NUM_CHANNELS];
+  int pitch;         // the held note, or -1 if the voice has been released
+  uint32_t age;      // the note count at which the voice was last triggered
+  int silentBlocks;  // the number of consecutive silent output blocks
+  bool isSleeping;   // true if the voice skipped the last block
+  bool isFadingOut;  // true if the voice is rendering its last block before being frozen
+} Voice;
+
+typedef struct {
+  Voice *voices;
+  int numVoices;
+  int maxVoices;     // only the first maxVoices voices are played, the rest are frozen
+  int blockSize;
+  uint32_t numNotes; // the total number of notes triggered
+  VoiceContextFunctions f;
+
+  // worker threads, in addition to the calling thread
+  pthread_t *threads;
+  int numThreads;
+  pthread_barrier_t startBarrier;
+  pthread_barrier_t doneBarrier;
+  atomic_int nextVoice;
+  volatile bool isRunning;
+} VoicePool;
+
+/**
+ * Creates numVoices instances of the same patch. Voices are processed on
+ * numThreads threads, including the one which calls voicepool_process().
+ */
+void voicepool_init(VoicePool *o, const VoiceContextFunctions *f,
+    int numVoices, int numThreads, double sampleRate, int blockSize);
+
+void voicepool_free(VoicePool *o);
+
+/** Schedules a float for the named receiver of every voice. */
+void voicepool_scheduleFloatForReceiver(VoicePool *o, double delayMs,
+    const char *receiverName, float x);
+
+/**
+ * Routes a note to a voice. A note-on goes to the voice already holding the pitch,
+ * else to the released voice which has been silent the longest, else the
+ * oldest held voice is stolen.
+ * A note-off (velocity 0) goes to the voice holding the pitch, if any.
+ */
+void voicepool_scheduleNote(VoicePool *o, double delayMs,
+    int pitch, int velocity, int channel, int command);
+
+/**
+ * Limits the polyphony to the first n voices. Voices above the limit are
+ * released, faded out over one block and then frozen: they are not heard or
+ * given notes until the limit is raised again. Their clocks keep running, and
+ * they are only processed in blocks in which a message is due.
+ */
+void voicepool_setMaxVoices(VoicePool *o, int n);
+
+/** Processes all voices and sums them into outputBuffers. */
+void voicepool_process(VoicePool *o, float **outputBuffers);
+
+#endif // _HARPY_VOICE_POOL_